@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 #include <optional>
 
@@ -9,11 +11,25 @@
 
 namespace location {
 
+// Область запроса MapTile: плитка x, y полной карты, разбитой на 2^zoom x 2^zoom частей,
+// либо прямоугольник координат bounds (min и max), вписанный в размеры карты
+struct TileArea {
+	int zoom = 0;
+	int x = 0;
+	int y = 0;
+	std::optional<std::pair<geo::Coordinates, geo::Coordinates>> bounds;
+};
+
 struct Request {
 	int id;
 	std::string type;
 	std::string name;
 	std::string opt_str;
+	geo::Coordinates coordinates = {0.0, 0.0};
+	std::optional<double> radius;
+	std::optional<int> count;
+	bool fuzzy = false;
+	TileArea tile;
 };
 
 struct RouteData {
@@ -27,12 +43,26 @@ struct RouteData {
 struct Stop {
 	std::string name;
 	geo::Coordinates coordinates;
+	uint32_t id = 0;
 };
 
 struct Bus {
 	std::string route_number;
 	bool is_circular;
 	std::vector<const Stop*> route_stops;
+	uint32_t id = 0;
+	int unique_stops = 0;
+	// forward_distances[i] - перегон route_stops[i] -> route_stops[i + 1], backward_distances[i] - обратно
+	std::vector<int> forward_distances;
+	std::vector<int> backward_distances;
+	// prefix[i] - сумма перегонов от route_stops[0] до route_stops[i] в соответствующем направлении
+	std::vector<int> forward_prefix;
+	std::vector<int> backward_prefix;
+};
+
+struct NearbyStop {
+	const Stop* stop;
+	double distance;
 };
 
 } //namespace location
@@ -1,13 +1,55 @@
 #include "geo.h"
 
+#include <algorithm>
+
 namespace geo {
 
+namespace {
+
+// для совпадающих точек погрешность округления может дать аргумент acos чуть больше 1
+inline double CentralAngleToDistance(double cos_angle) {
+	return std::acos(std::min(1.0, cos_angle)) * EARTH_RADIUS;
+}
+
+}// namespace
+
+FixedCoordinates ToFixed(Coordinates point) {
+	return {static_cast<int32_t>(std::lround(point.lat * 1e6)), static_cast<int32_t>(std::lround(point.lng * 1e6))};
+}
+
+Coordinates FromFixed(FixedCoordinates point) {
+	return {point.lat / 1e6, point.lng / 1e6};
+}
+
+PreparedCoordinates Prepare(Coordinates point) {
+	return {point.lat, point.lng, std::sin(point.lat * DEGREE_TO_RADIAN), std::cos(point.lat * DEGREE_TO_RADIAN)};
+}
+
 double ComputeDistance(Coordinates from, Coordinates to) {
-	using namespace std;
-	static const double dr = 3.1415926535 / 180.;
-	return acos(sin(from.lat * dr) * sin(to.lat * dr)
-				+ cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-		* 6371000;
+	return ComputeDistance(Prepare(from), Prepare(to));
+}
+
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to) {
+	return CentralAngleToDistance(from.sin_lat * to.sin_lat
+								  + from.cos_lat * to.cos_lat * std::cos(std::abs(from.lng - to.lng) * DEGREE_TO_RADIAN));
+}
+
+void ComputeDistances(const PreparedCoordinates* from, const PreparedCoordinates* to, double* out, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = from[i].sin_lat * to[i].sin_lat + from[i].cos_lat * to[i].cos_lat * std::cos(std::abs(from[i].lng - to[i].lng) * DEGREE_TO_RADIAN);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = CentralAngleToDistance(out[i]);
+	}
+}
+
+void ComputeDistances(const PreparedCoordinates& from, const PreparedCoordinates* to, double* out, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = from.sin_lat * to[i].sin_lat + from.cos_lat * to[i].cos_lat * std::cos(std::abs(from.lng - to[i].lng) * DEGREE_TO_RADIAN);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = CentralAngleToDistance(out[i]);
+	}
 }
 
 }// namespace geo
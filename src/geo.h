@@ -1,14 +1,44 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 
 namespace geo {
 
+inline const double EARTH_RADIUS = 6371000;
+inline const double DEGREE_TO_RADIAN = 3.1415926535 / 180.;
+
 struct Coordinates {
 	double lat;
 	double lng;
 };
 
+// Координаты в миллионных долях градуса (около 0.1 м) для компактной записи базы
+struct FixedCoordinates {
+	int32_t lat;
+	int32_t lng;
+};
+
+FixedCoordinates ToFixed(Coordinates point);
+Coordinates FromFixed(FixedCoordinates point);
+
+// Координаты с заранее посчитанными синусом и косинусом широты
+struct PreparedCoordinates {
+	double lat;
+	double lng;
+	double sin_lat;
+	double cos_lat;
+};
+
+PreparedCoordinates Prepare(Coordinates point);
+
 double ComputeDistance(Coordinates from, Coordinates to);
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to);
+
+// Пакетный расчёт: out[i] = ComputeDistance(from[i], to[i]), результат совпадает со скалярной версией
+void ComputeDistances(const PreparedCoordinates* from, const PreparedCoordinates* to, double* out, size_t count);
+// out[i] = ComputeDistance(from, to[i])
+void ComputeDistances(const PreparedCoordinates& from, const PreparedCoordinates* to, double* out, size_t count);
 
 }// namespace geo
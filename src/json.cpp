@@ -1,77 +1,372 @@
 #include "json.h"
+#include "number_format.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iterator>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace json {
 
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+#if defined(__GNUC__)
+inline int CountTrailingZeros(uint64_t mask) {
+	return __builtin_ctzll(mask);
+}
+#else
+inline int CountTrailingZeros(uint64_t mask) {
+	int result = 0;
+	for (; !(mask & 1); mask >>= 1) {
+		++result;
+	}
+	return result;
+}
+#endif
+
+// Битовые маски классов символов блока из 64 байт: бит i относится к байту i
+struct BlockMasks {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t space;
+	uint64_t structural;
+	uint64_t line_end;
+};
+
+#if defined(__AVX2__)
+
+inline uint64_t Mask32(__m256i matches) {
+	return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+}
 
-std::string LoadLiteral(std::istream& input) {
-	std::string s;
-	while (std::isalpha(input.peek())) {
-		s.push_back(static_cast<char>(input.get()));
+BlockMasks ClassifyBlock(const char* block) {
+	BlockMasks masks{};
+	for (int half = 0; half < 2; ++half) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + half * 32));
+		// '\t', '\n', '\v', '\f', '\r' - это 9..13, как у std::isspace
+		const __m256i control = _mm256_sub_epi8(chunk, _mm256_set1_epi8(9));
+		const __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+				_mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control));
+		// '[' и ']' отличаются от '{' и '}' только битом 0x20
+		const __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+		const __m256i structural = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))));
+		const __m256i line_end = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+				_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+		const int shift = half * 32;
+		masks.quote |= Mask32(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))) << shift;
+		masks.backslash |= Mask32(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))) << shift;
+		masks.space |= Mask32(space) << shift;
+		masks.structural |= Mask32(structural) << shift;
+		masks.line_end |= Mask32(line_end) << shift;
 	}
-	return s;
+	return masks;
 }
 
-Node LoadArray(std::istream& input) {
-	std::vector<Node> result;
+#elif defined(__SSE2__) || defined(_M_X64)
 
-	for (char c; input >> c && c != ']';) {
-		if (c != ',') {
-			input.putback(c);
-		}
-		result.push_back(LoadNode(input));
+inline uint64_t Mask16(__m128i matches) {
+	return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+}
+
+BlockMasks ClassifyBlock(const char* block) {
+	BlockMasks masks{};
+	for (int quarter = 0; quarter < 4; ++quarter) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + quarter * 16));
+		// '\t', '\n', '\v', '\f', '\r' - это 9..13, как у std::isspace
+		const __m128i control = _mm_sub_epi8(chunk, _mm_set1_epi8(9));
+		const __m128i space = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+				_mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control));
+		// '[' и ']' отличаются от '{' и '}' только битом 0x20
+		const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+		const __m128i structural = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+		const __m128i line_end = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+				_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+		const int shift = quarter * 16;
+		masks.quote |= Mask16(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))) << shift;
+		masks.backslash |= Mask16(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))) << shift;
+		masks.space |= Mask16(space) << shift;
+		masks.structural |= Mask16(structural) << shift;
+		masks.line_end |= Mask16(line_end) << shift;
 	}
-	if (!input) {
-		throw ParsingError("Array parsing error"s);
+	return masks;
+}
+
+#else
+
+BlockMasks ClassifyBlock(const char* block) {
+	BlockMasks masks{};
+	for (int i = 0; i < 64; ++i) {
+		const uint64_t bit = uint64_t{1} << i;
+		switch (block[i]) {
+			case '"':
+				masks.quote |= bit;
+				break;
+			case '\\':
+				masks.backslash |= bit;
+				break;
+			case '\n':
+			case '\r':
+				masks.line_end |= bit;
+				[[fallthrough]];
+			case ' ':
+			case '\t':
+			case '\v':
+			case '\f':
+				masks.space |= bit;
+				break;
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',':
+				masks.structural |= bit;
+				break;
+		}
 	}
-	return Node(std::move(result));
+	return masks;
 }
 
-Node LoadDict(std::istream& input) {
-	Dict dict;
+#endif
 
-	for (char c; input >> c && c != '}';) {
-		if (c == '"') {
-			std::string key = LoadString(input).AsString();
-			if (input >> c && c == ':') {
-				if (dict.find(key) != dict.end()) {
-					throw ParsingError("Duplicate key '"s + key + "' have been found");
-				}
-				dict.emplace(std::move(key), LoadNode(input));
+// Бит i результата - чётность числа единиц в битах 0..i
+inline uint64_t PrefixXor(uint64_t mask) {
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	mask ^= mask << 16;
+	mask ^= mask << 32;
+	return mask;
+}
+
+// Первая стадия разбора: позиции символов, которые нужны второй стадии. Это структурные символы
+// и начала чисел и литералов вне строк, кавычки, а также '\' и переводы строки внутри строк
+// (строка без них берётся целиком до следующей кавычки). Текст индексируется окнами,
+// чтобы индекс не занимал память, сравнимую с документом.
+class StructuralIndex {
+public:
+	StructuralIndex(const char* begin, const char* end)
+		: scanned_(begin), end_(end) {
+		positions_.reserve(WINDOW_SIZE);
+	}
+
+	// Следующая позиция индекса или nullptr, если текст кончился
+	const char* Peek() {
+		while (current_ == positions_.size()) {
+			if (scanned_ == end_) {
+				return nullptr;
+			}
+			ScanWindow();
+		}
+		return window_ + positions_[current_];
+	}
+	void Advance() {
+		++current_;
+	}
+
+private:
+	static constexpr size_t WINDOW_SIZE = 1 << 16;
+
+	std::vector<uint32_t> positions_;
+	size_t current_ = 0;
+	const char* window_ = nullptr;
+	const char* scanned_;
+	const char* end_;
+	// состояние на границе блоков: внутри строки, экранирован первый символ, продолжается число или литерал
+	uint64_t in_string_ = 0;
+	uint64_t escaped_carry_ = 0;
+	uint64_t scalar_carry_ = 0;
+
+	void ScanWindow() {
+		window_ = scanned_;
+		const size_t rest = static_cast<size_t>(end_ - scanned_);
+		const char* window_end = scanned_ + std::min(rest, WINDOW_SIZE);
+		positions_.clear();
+		current_ = 0;
+		for (; window_end - scanned_ >= 64; scanned_ += 64) {
+			ScanBlock(ClassifyBlock(scanned_), static_cast<uint32_t>(scanned_ - window_), ~uint64_t{0});
+		}
+		if (scanned_ != window_end) {
+			// хвост дополняется пробелами до целого блока
+			char block[64];
+			const size_t size = static_cast<size_t>(window_end - scanned_);
+			std::memset(block, ' ', sizeof(block));
+			std::memcpy(block, scanned_, size);
+			ScanBlock(ClassifyBlock(block), static_cast<uint32_t>(scanned_ - window_), (uint64_t{1} << size) - 1);
+			scanned_ = window_end;
+		}
+	}
+
+	void ScanBlock(const BlockMasks& masks, uint32_t offset, uint64_t valid) {
+		// '\', который сам не экранирован, экранирует следующий символ
+		uint64_t escaped = escaped_carry_;
+		uint64_t escapers = masks.backslash & ~escaped_carry_;
+		escaped_carry_ = 0;
+		while (escapers) {
+			const int i = CountTrailingZeros(escapers);
+			if (i == 63) {
+				escaped_carry_ = 1;
 			} else {
-				throw ParsingError(": is expected but '"s + c + "' has been found"s);
+				escaped |= uint64_t{1} << (i + 1);
+				escapers &= ~(uint64_t{1} << (i + 1));
 			}
-		} else if (c != ',') {
-			throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+			escapers &= escapers - 1;
+		}
+		const uint64_t quote = masks.quote & ~escaped;
+		// открывающая кавычка и символы строки - единицы, закрывающая кавычка - ноль
+		const uint64_t in_string = PrefixXor(quote) ^ in_string_;
+		in_string_ = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+		const uint64_t scalar = ~(masks.space | masks.structural | quote) & ~in_string;
+		const uint64_t scalar_begin = scalar & ~((scalar << 1) | scalar_carry_);
+		scalar_carry_ = scalar >> 63;
+		uint64_t found = ((masks.structural | scalar_begin) & ~in_string) | quote
+				| ((masks.backslash | masks.line_end) & in_string);
+		found &= valid;
+		while (found) {
+			positions_.push_back(offset + static_cast<uint32_t>(CountTrailingZeros(found)));
+			found &= found - 1;
 		}
 	}
-	if (!input) {
-		throw ParsingError("Dictionary parsing error"s);
+};
+
+// Вторая стадия: позиция разбора в непрерывном тексте документа. Пробелы между значимыми
+// символами не просматриваются, разбор переходит к следующей позиции индекса.
+struct Input {
+	const char* pos;
+	const char* end;
+	StructuralIndex index;
+
+	Input(const char* begin, const char* end)
+		: pos(begin), end(end), index(begin, end) {
+	}
+
+	bool AtEnd() const {
+		return pos == end;
+	}
+	int Peek() const {
+		return pos != end ? static_cast<unsigned char>(*pos) : EOF;
+	}
+	// Пропускает пробельные символы и читает следующий символ; false в конце текста
+	bool NextToken(char& c) {
+		// позиции, пройденные посимвольным разбором
+		const char* next = index.Peek();
+		while (next && next < pos) {
+			index.Advance();
+			next = index.Peek();
+		}
+		if (next != pos && pos != end && !std::isspace(static_cast<unsigned char>(*pos))) {
+			// символ, которого нет в индексе, бывает только в некорректном документе
+			c = *pos++;
+			return true;
+		}
+		if (!next) {
+			pos = end;
+			return false;
+		}
+		index.Advance();
+		pos = next;
+		c = *pos++;
+		return true;
+	}
+};
+
+// Разбор порождает события для Events: json::Handler при потоковом чтении или NodeBuilder,
+// вызовы которого благодаря final не виртуальные
+template <typename Events>
+void ParseNode(Input& input, Events& events);
+
+std::string_view LoadLiteral(Input& input) {
+	const char* begin = input.pos;
+	while (std::isalpha(input.Peek())) {
+		++input.pos;
+	}
+	return {begin, static_cast<size_t>(input.pos - begin)};
+}
+
+template <typename Events>
+void ParseArray(Input& input, Events& events) {
+	events.StartArray();
+
+	char c = 0;
+	bool closed = false;
+	while (input.NextToken(c)) {
+		if (c == ']') {
+			closed = true;
+			break;
+		}
+		if (c != ',') {
+			--input.pos;
+		}
+		ParseNode(input, events);
+	}
+	if (!closed) {
+		throw ParsingError("Array parsing error"s);
 	}
-	return Node(std::move(dict));
+	events.EndArray();
 }
 
-Node LoadString(std::istream& input) {
-	auto it = std::istreambuf_iterator<char>(input);
-	auto end = std::istreambuf_iterator<char>();
-	std::string s;
+// Строка без escape-последовательностей возвращается как string_view на текст документа
+// (persistent = true), иначе собирается в storage
+std::string_view LoadString(Input& input, std::string& storage, bool& persistent) {
+	const char* begin = input.pos;
+	// в индексе после открывающей кавычки либо закрывающая, либо '\' или перевод строки
+	const char* it = input.index.Peek();
+	if (it && *it == '"') {
+		input.index.Advance();
+		input.pos = it + 1;
+		persistent = true;
+		return {begin, static_cast<size_t>(it - begin)};
+	}
+	it = begin;
+
+	std::string& s = storage;
+	s.clear();
 	while (true) {
-		if (it == end) {
+		// участок до следующей позиции индекса - '\', перевода строки или закрывающей кавычки -
+		// копируется целиком; '\', экранированный предыдущим, уже пройден
+		const char* next = input.index.Peek();
+		while (next && next < it) {
+			input.index.Advance();
+			next = input.index.Peek();
+		}
+		if (!next) {
 			throw ParsingError("String parsing error");
 		}
+		input.index.Advance();
+		s.append(it, next);
+		it = next;
 		const char ch = *it;
 		if (ch == '"') {
 			++it;
 			break;
 		} else if (ch == '\\') {
 			++it;
-			if (it == end) {
+			if (it == input.end) {
 				throw ParsingError("String parsing error");
 			}
 			const char escaped_char = *(it);
@@ -101,56 +396,80 @@ Node LoadString(std::istream& input) {
 		}
 		++it;
 	}
+	input.pos = it;
+	persistent = false;
+	return s;
+}
+
+template <typename Events>
+void ParseDict(Input& input, Events& events) {
+	events.StartDict();
 
-	return Node(std::move(s));
+	std::string storage;
+	char c = 0;
+	bool closed = false;
+	while (input.NextToken(c)) {
+		if (c == '}') {
+			closed = true;
+			break;
+		}
+		if (c == '"') {
+			bool persistent = false;
+			const std::string_view key = LoadString(input, storage, persistent);
+			if (input.NextToken(c) && c == ':') {
+				events.Key(key, persistent);
+				ParseNode(input, events);
+			} else {
+				throw ParsingError(": is expected but '"s + c + "' has been found"s);
+			}
+		} else if (c != ',') {
+			throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+		}
+	}
+	if (!closed) {
+		throw ParsingError("Dictionary parsing error"s);
+	}
+	events.EndDict();
 }
 
-Node LoadBool(std::istream& input) {
+Node LoadBool(Input& input) {
 	const auto s = LoadLiteral(input);
 	if (s == "true"sv) {
 		return Node{true};
 	} else if (s == "false"sv) {
 		return Node{false};
 	} else {
-		throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+		throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
 	}
 }
 
-Node LoadNull(std::istream& input) {
+Node LoadNull(Input& input) {
 	if (auto literal = LoadLiteral(input); literal == "null"sv) {
 		return Node{nullptr};
 	} else {
-		throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+		throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
 	}
 }
 
-Node LoadNumber(std::istream& input) {
-	std::string parsed_num;
+Node LoadNumber(Input& input) {
+	const char* begin = input.pos;
 
-	// Считывает в parsed_num очередной символ из input
-	auto read_char = [&parsed_num, &input] {
-		parsed_num += static_cast<char>(input.get());
-		if (!input) {
-			throw ParsingError("Failed to read number from stream"s);
-		}
-	};
-
-	// Считывает одну или более цифр в parsed_num из input
-	auto read_digits = [&input, read_char] {
-		if (!std::isdigit(input.peek())) {
+	// Пропускает одну или более цифр
+	auto read_digits = [&input] {
+		if (!std::isdigit(input.Peek())) {
 			throw ParsingError("A digit is expected"s);
 		}
-		while (std::isdigit(input.peek())) {
-			read_char();
+		while (std::isdigit(input.Peek())) {
+			++input.pos;
 		}
 	};
 
-	if (input.peek() == '-') {
-		read_char();
+	if (input.Peek() == '-') {
+		++input.pos;
 	}
 	// Парсим целую часть числа
-	if (input.peek() == '0') {
-		read_char();
+	if (input.Peek() == '0') {
+		++input.pos;
 		// После 0 в JSON не могут идти другие цифры
 	} else {
 		read_digits();
@@ -158,50 +477,68 @@ Node LoadNumber(std::istream& input) {
 
 	bool is_int = true;
 	// Парсим дробную часть числа
-	if (input.peek() == '.') {
-		read_char();
+	if (input.Peek() == '.') {
+		++input.pos;
 		read_digits();
 		is_int = false;
 	}
 
 	// Парсим экспоненциальную часть числа
-	if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-		read_char();
-		if (ch = input.peek(); ch == '+' || ch == '-') {
-			read_char();
+	if (int ch = input.Peek(); ch == 'e' || ch == 'E') {
+		++input.pos;
+		if (ch = input.Peek(); ch == '+' || ch == '-') {
+			++input.pos;
 		}
 		read_digits();
 		is_int = false;
 	}
 
-	try {
-		if (is_int) {
-			// Сначала пробуем преобразовать строку в int
-			try {
-				return std::stoi(parsed_num);
-			} catch (...) {
-				// В случае неудачи, например, при переполнении
-				// код ниже попробует преобразовать строку в double
-			}
+	// Число преобразуется прямо из текста документа. Сначала пробуем int, при переполнении - double.
+	if (is_int) {
+		int value = 0;
+		if (const auto [end, error] = std::from_chars(begin, input.pos, value); error == std::errc{} && end == input.pos) {
+			return value;
 		}
+	}
+#if defined(__cpp_lib_to_chars)
+	double value = 0;
+	// денормализованные значения, как и у std::stod, считаются выходом за диапазон
+	if (const auto [end, error] = std::from_chars(begin, input.pos, value); error == std::errc{} && end == input.pos
+			&& (value == 0 || std::fabs(value) >= std::numeric_limits<double>::min())) {
+		return value;
+	}
+	throw ParsingError("Failed to convert "s + std::string(begin, input.pos) + " to number"s);
+#else
+	// без from_chars для double
+	const std::string parsed_num(begin, input.pos);
+	try {
 		return std::stod(parsed_num);
 	} catch (...) {
 		throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
 	}
+#endif
 }
 
-Node LoadNode(std::istream& input) {
+template <typename Events>
+void ParseNode(Input& input, Events& events) {
 	char c;
-	if (!(input >> c)) {
+	if (!input.NextToken(c)) {
 		throw ParsingError("Unexpected EOF"s);
 	}
 	switch (c) {
 		case '[':
-			return LoadArray(input);
+			ParseArray(input, events);
+			break;
 		case '{':
-			return LoadDict(input);
-		case '"':
-			return LoadString(input);
+			ParseDict(input, events);
+			break;
+		case '"': {
+			std::string storage;
+			bool persistent = false;
+			const std::string_view value = LoadString(input, storage, persistent);
+			events.String(value, persistent);
+			break;
+		}
 		case 't':
 			// Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
 			// подсказкой компилятору и человеку, что здесь программист явно задумывал
@@ -211,30 +548,41 @@ Node LoadNode(std::istream& input) {
 			// литералов true либо false
 			[[fallthrough]];
 		case 'f':
-			input.putback(c);
-			return LoadBool(input);
+			--input.pos;
+			events.Value(LoadBool(input));
+			break;
 		case 'n':
-			input.putback(c);
-			return LoadNull(input);
+			--input.pos;
+			events.Value(LoadNull(input));
+			break;
 		default:
-			input.putback(c);
-			return LoadNumber(input);
+			--input.pos;
+			events.Value(LoadNumber(input));
+			break;
 	}
 }
 
 struct PrintContext {
-	std::ostream& out;
+	OutputBuffer& out;
 	int indent_step = 4;
 	int indent = 0;
+	// без переводов строк и отступов
+	bool compact = false;
 
 	void PrintIndent() const {
-		for (int i = 0; i < indent; ++i) {
-			out.put(' ');
+		out.Fill(' ', indent);
+	}
+
+	// перевод строки и отступ перед элементом или закрывающей скобкой
+	void PrintLineBreak() const {
+		if (!compact) {
+			out.Put('\n');
+			PrintIndent();
 		}
 	}
 
 	PrintContext Indented() const {
-		return {out, indent_step, indent_step + indent};
+		return {out, indent_step, indent_step + indent, compact};
 	}
 };
 
@@ -242,41 +590,77 @@ void PrintNode(const Node& value, const PrintContext& ctx);
 
 template <typename Value>
 void PrintValue(const Value& value, const PrintContext& ctx) {
-	ctx.out << value;
+	ctx.out.Write(value);
+}
+
+// Первый символ, который PrintString экранирует, или end. Текст просматривается блоками по 32 или 16 байт.
+const char* FindEscaped(const char* it, const char* end) {
+#if defined(__AVX2__)
+	for (; end - it >= 32; it += 32) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+		const __m256i escaped = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+		if (const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(escaped))) {
+			return it + CountTrailingZeros(mask);
+		}
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	for (; end - it >= 16; it += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+		const __m128i escaped = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+		if (const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(escaped))) {
+			return it + CountTrailingZeros(mask);
+		}
+	}
+#endif
+	for (; it != end; ++it) {
+		if (*it == '"' || *it == '\\' || *it == '\n' || *it == '\r') {
+			break;
+		}
+	}
+	return it;
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
-	out.put('"');
-	for (const char c : value) {
-		switch (c) {
+// Участки без экранируемых символов выводятся целиком
+void PrintString(std::string_view value, OutputBuffer& out) {
+	out.Put('"');
+	const char* it = value.data();
+	const char* end = it + value.size();
+	while (true) {
+		const char* escaped = FindEscaped(it, end);
+		out.Write({it, static_cast<size_t>(escaped - it)});
+		if (escaped == end) {
+			break;
+		}
+		switch (*escaped) {
 			case '\r':
-				out << "\\r"sv;
+				out.Write("\\r"sv);
 				break;
 			case '\n':
-				out << "\\n"sv;
+				out.Write("\\n"sv);
 				break;
-			case '"':
-				// Символы " и \ выводятся как \" или \\, соответственно
-				[[fallthrough]];
-			case '\\':
-				out.put('\\');
-				[[fallthrough]];
 			default:
-				out.put(c);
+				// Символы " и \ выводятся как \" или \\, соответственно
+				out.Put('\\');
+				out.Put(*escaped);
 				break;
 		}
+		it = escaped + 1;
 	}
-	out.put('"');
+	out.Put('"');
 }
 
 template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
+void PrintValue<std::string_view>(const std::string_view& value, const PrintContext& ctx) {
 	PrintString(value, ctx.out);
 }
 
 template <>
 void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-	ctx.out << "null"sv;
+	ctx.out.Write("null"sv);
 }
 
 // В специализаци шаблона PrintValue для типа bool параметр value передаётся
@@ -285,67 +669,522 @@ void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx)
 // void PrintValue(bool value, const PrintContext& ctx);
 template <>
 void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-	ctx.out << (value ? "true"sv : "false"sv);
+	ctx.out.Write(value ? "true"sv : "false"sv);
 }
 
+// Пустые массив и словарь без compact выводятся с пустой строкой внутри
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-	std::ostream& out = ctx.out;
-	out << "[\n"sv;
+	OutputBuffer& out = ctx.out;
+	out.Put('[');
 	bool first = true;
 	auto inner_ctx = ctx.Indented();
 	for (const Node& node : nodes) {
 		if (first) {
 			first = false;
 		} else {
-			out << ",\n"sv;
+			out.Put(',');
 		}
-		inner_ctx.PrintIndent();
+		inner_ctx.PrintLineBreak();
 		PrintNode(node, inner_ctx);
 	}
-	out.put('\n');
-	ctx.PrintIndent();
-	out.put(']');
+	if (nodes.empty() && !ctx.compact) {
+		out.Put('\n');
+	}
+	ctx.PrintLineBreak();
+	out.Put(']');
 }
 
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-	std::ostream& out = ctx.out;
-	out << "{\n"sv;
+	OutputBuffer& out = ctx.out;
+	out.Put('{');
 	bool first = true;
 	auto inner_ctx = ctx.Indented();
 	for (const auto& [key, node] : nodes) {
 		if (first) {
 			first = false;
 		} else {
-			out << ",\n"sv;
+			out.Put(',');
 		}
-		inner_ctx.PrintIndent();
-		PrintString(key, ctx.out);
-		out << ": "sv;
+		inner_ctx.PrintLineBreak();
+		PrintString(key, out);
+		out.Write(ctx.compact ? ":"sv : ": "sv);
 		PrintNode(node, inner_ctx);
 	}
-	out.put('\n');
-	ctx.PrintIndent();
-	out.put('}');
+	if (nodes.empty() && !ctx.compact) {
+		out.Put('\n');
+	}
+	ctx.PrintLineBreak();
+	out.Put('}');
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx) {
-	std::visit(
-		[&ctx](const auto& value) {
-			PrintValue(value, ctx);
-		},
-		node.GetValue());
+	if (node.IsNull()) {
+		PrintValue(nullptr, ctx);
+	} else if (node.IsBool()) {
+		PrintValue(node.AsBool(), ctx);
+	} else if (node.IsInt()) {
+		PrintValue(node.AsInt(), ctx);
+	} else if (node.IsPureDouble()) {
+		PrintValue(node.AsDouble(), ctx);
+	} else if (node.IsString()) {
+		PrintValue(node.AsString(), ctx);
+	} else if (node.IsArray()) {
+		PrintValue(node.AsArray(), ctx);
+	} else {
+		PrintValue(node.AsDict(), ctx);
+	}
+}
+
+// Небольшой словарь быстрее просмотреть подряд, чем искать в нём двоичным поиском
+const size_t LINEAR_SEARCH_SIZE = 8;
+// С этого размера повторы ключей при разборе ищутся по хеш-таблице
+const size_t HASHED_KEYS_SIZE = 32;
+
+}// namespace
+
+namespace {
+
+// Объект контейнера размещается в том же ресурсе, что и его элементы
+template <typename Container>
+Container* Allocate(Container&& value) {
+	std::pmr::memory_resource* resource = value.get_allocator().resource();
+	return new (resource->allocate(sizeof(Container), alignof(Container))) Container(std::move(value));
+}
+
+template <typename Container>
+void Deallocate(Container* value) {
+	std::pmr::memory_resource* resource = value->get_allocator().resource();
+	value->~Container();
+	resource->deallocate(value, sizeof(Container), alignof(Container));
 }
 
 }// namespace
 
+Node::Node(Array value)
+	: type_(Type::ARRAY) {
+	Store(Allocate(std::move(value)));
+}
+
+Node::Node(Dict value)
+	: type_(Type::DICT) {
+	Store(Allocate(std::move(value)));
+}
+
+Node::Node(const Node& other)
+	: type_(other.type_) {
+	switch (type_) {
+		case Type::ARRAY:
+			Store(Allocate(Array(other.AsArray())));
+			break;
+		case Type::DICT:
+			Store(Allocate(Dict(other.AsDict())));
+			break;
+		case Type::STRING:
+			type_ = Type::NUL;
+			AssignString(other.AsString(), false);
+			break;
+		default:
+			std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+			break;
+	}
+}
+
+Node::~Node() {
+	switch (type_) {
+		case Type::ARRAY:
+			Deallocate(Load<Array*>());
+			break;
+		case Type::DICT:
+			Deallocate(Load<Dict*>());
+			break;
+		case Type::STRING: {
+			// перед символами строки лежит указатель на её ресурс
+			char* data = Load<char*>() - sizeof(std::pmr::memory_resource*);
+			std::pmr::memory_resource* resource;
+			std::memcpy(&resource, data, sizeof(resource));
+			resource->deallocate(data, sizeof(resource) + Load<uint32_t>(SIZE_OFFSET), alignof(std::pmr::memory_resource*));
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void Node::AssignString(std::string_view value, bool view, std::pmr::memory_resource* resource) {
+	if (value.size() <= SHORT_SIZE_OFFSET) {
+		std::memcpy(bytes_, value.data(), value.size());
+		bytes_[SHORT_SIZE_OFFSET] = static_cast<char>(value.size());
+		type_ = Type::SHORT_STRING;
+		return;
+	}
+	if (value.size() > std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("JSON string is too long"s);
+	}
+	if (view) {
+		Store(value.data());
+		type_ = Type::STRING_VIEW;
+	} else {
+		char* data = static_cast<char*>(resource->allocate(sizeof(resource) + value.size(), alignof(std::pmr::memory_resource*)));
+		std::memcpy(data, &resource, sizeof(resource));
+		std::memcpy(data + sizeof(resource), value.data(), value.size());
+		Store<const char*>(data + sizeof(resource));
+		type_ = Type::STRING;
+	}
+	Store(static_cast<uint32_t>(value.size()), SIZE_OFFSET);
+}
+
+bool Node::operator==(const Node& rhs) const {
+	if (IsString() || rhs.IsString()) {
+		return IsString() && rhs.IsString() && AsString() == rhs.AsString();
+	}
+	if (type_ != rhs.type_) {
+		return false;
+	}
+	switch (type_) {
+		case Type::NUL:
+			return true;
+		case Type::BOOL:
+			return AsBool() == rhs.AsBool();
+		case Type::INT:
+			return AsInt() == rhs.AsInt();
+		case Type::DOUBLE:
+			return AsDouble() == rhs.AsDouble();
+		case Type::ARRAY:
+			return AsArray() == rhs.AsArray();
+		default:
+			return AsDict() == rhs.AsDict();
+	}
+}
+
+Dict::Dict(Entries entries)
+	: entries_(std::move(entries)) {
+	const auto key_less = [](const value_type& lhs, const value_type& rhs) {
+		return lhs.first.View() < rhs.first.View();
+	};
+	if (entries_.size() <= LINEAR_SEARCH_SIZE) {
+		// вставками: устойчиво и без временного буфера std::stable_sort
+		for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+			std::rotate(std::upper_bound(entries_.begin(), it, *it, key_less), it, std::next(it));
+		}
+	} else {
+		std::stable_sort(entries_.begin(), entries_.end(), key_less);
+	}
+	entries_.erase(std::unique(entries_.begin(), entries_.end(), [](const value_type& lhs, const value_type& rhs) {
+		return lhs.first.View() == rhs.first.View();
+	}), entries_.end());
+}
+
+Dict::const_iterator Dict::find(std::string_view key) const {
+	if (entries_.size() <= LINEAR_SEARCH_SIZE) {
+		return std::find_if(entries_.begin(), entries_.end(), [key](const value_type& entry) {
+			return entry.first.View() == key;
+		});
+	}
+	const auto found = std::lower_bound(entries_.begin(), entries_.end(), key, [](const value_type& entry, std::string_view key) {
+		return entry.first.View() < key;
+	});
+	return found != entries_.end() && found->first.View() == key ? found : entries_.end();
+}
+
+const Node& Dict::at(std::string_view key) const {
+	const auto found = find(key);
+	if (found == end()) {
+		throw std::out_of_range("Dict::at: no key '"s + std::string(key) + "'"s);
+	}
+	return found->second;
+}
+
+std::pair<Dict::const_iterator, bool> Dict::emplace(DictKey key, Node value) {
+	const auto found = std::lower_bound(entries_.begin(), entries_.end(), key.View(), [](const value_type& entry, std::string_view key) {
+		return entry.first.View() < key;
+	});
+	if (found != entries_.end() && found->first.View() == key.View()) {
+		return {found, false};
+	}
+	return {entries_.emplace(found, std::move(key), std::move(value)), true};
+}
+
+bool Dict::operator==(const Dict& rhs) const {
+	return std::equal(entries_.begin(), entries_.end(), rhs.entries_.begin(), rhs.entries_.end(),
+			[](const value_type& lhs, const value_type& rhs) {
+				return lhs.first.View() == rhs.first.View() && lhs.second == rhs.second;
+			});
+}
+
+std::shared_ptr<const Buffer> Buffer::MapFile(const std::string& path) {
+	std::shared_ptr<Buffer> buffer(new Buffer());
+#if defined(__unix__) || defined(__APPLE__)
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open "s + path);
+	}
+	struct stat file_stat;
+	if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+		void* mapping = ::mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			buffer->mapping_ = mapping;
+			buffer->mapping_size_ = static_cast<size_t>(file_stat.st_size);
+			buffer->text_ = {static_cast<const char*>(mapping), buffer->mapping_size_};
+		}
+	}
+	::close(fd);
+	if (buffer->mapping_) {
+		return buffer;
+	}
+#endif
+	// без mmap файл читается целиком
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Failed to open "s + path);
+	}
+	return Read(input);
+}
+
+std::shared_ptr<const Buffer> Buffer::FromString(std::string text) {
+	std::shared_ptr<Buffer> buffer(new Buffer());
+	buffer->storage_ = std::move(text);
+	buffer->text_ = buffer->storage_;
+	return buffer;
+}
+
+std::shared_ptr<const Buffer> Buffer::Read(std::istream& input) {
+	std::shared_ptr<Buffer> buffer(new Buffer());
+	buffer->storage_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	buffer->text_ = buffer->storage_;
+	return buffer;
+}
+
+Buffer::~Buffer() {
+#if defined(__unix__) || defined(__APPLE__)
+	if (mapping_) {
+		::munmap(mapping_, mapping_size_);
+	}
+#endif
+}
+
 Document Load(std::istream& input) {
-	return Document{LoadNode(input)};
+	return Load(Buffer::Read(input));
+}
+
+void NodeBuilder::StartDict() {
+	stack_.push_back(Frame{true, Array(resource_), Dict::Entries(resource_), {}, {}});
+}
+
+void NodeBuilder::EndDict() {
+	Node value(Dict(std::move(stack_.back().entries)));
+	stack_.pop_back();
+	Add(std::move(value));
+}
+
+void NodeBuilder::StartArray() {
+	stack_.push_back(Frame{false, Array(resource_), Dict::Entries(resource_), {}, {}});
+}
+
+void NodeBuilder::EndArray() {
+	Node value(std::move(stack_.back().array));
+	stack_.pop_back();
+	Add(std::move(value));
+}
+
+void NodeBuilder::Key(std::string_view key, bool persistent) {
+	Frame& frame = stack_.back();
+	bool duplicate = false;
+	if (frame.entries.size() < HASHED_KEYS_SIZE) {
+		duplicate = std::any_of(frame.entries.begin(), frame.entries.end(), [key](const Dict::value_type& entry) {
+			return entry.first.View() == key;
+		});
+	} else {
+		if (frame.keys.empty()) {
+			for (const auto& entry : frame.entries) {
+				frame.keys.emplace(entry.first.View());
+			}
+		}
+		duplicate = !frame.keys.emplace(key).second;
+	}
+	if (duplicate) {
+		throw ParsingError("Duplicate key '"s + std::string(key) + "' have been found");
+	}
+	frame.key = persistent ? DictKey::View(key) : DictKey(key, resource_);
+}
+
+void NodeBuilder::String(std::string_view value, bool persistent) {
+	if (persistent) {
+		Add(Node::View(value));
+	} else {
+		Add(Node(value, resource_));
+	}
+}
+
+void NodeBuilder::Value(Node value) {
+	Add(std::move(value));
+}
+
+Node NodeBuilder::Extract() {
+	Node result = std::move(*root_);
+	root_.reset();
+	return result;
+}
+
+void NodeBuilder::Add(Node value) {
+	if (stack_.empty()) {
+		root_ = std::move(value);
+	} else if (Frame& frame = stack_.back(); frame.is_dict) {
+		frame.entries.emplace_back(std::move(*frame.key), std::move(value));
+	} else {
+		frame.array.push_back(std::move(value));
+	}
+}
+
+void Parse(const Buffer& buffer, Handler& handler) {
+	Input input(buffer.Text().data(), buffer.Text().data() + buffer.Text().size());
+	ParseNode(input, handler);
+}
+
+Document Load(std::shared_ptr<const Buffer> buffer) {
+	// узлы документа по объёму сравнимы с его текстом
+	auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(buffer->Text().size(), 4096));
+	Input input(buffer->Text().data(), buffer->Text().data() + buffer->Text().size());
+	NodeBuilder builder(arena.get());
+	ParseNode(input, builder);
+	return Document{builder.Extract(), std::move(buffer), std::move(arena)};
+}
+
+Document Load(std::shared_ptr<const Buffer> buffer, std::pmr::memory_resource* resource) {
+	Input input(buffer->Text().data(), buffer->Text().data() + buffer->Text().size());
+	NodeBuilder builder(resource);
+	ParseNode(input, builder);
+	return Document{builder.Extract(), std::move(buffer)};
+}
+
+Document LoadFile(const std::string& path) {
+	return Load(Buffer::MapFile(path));
+}
+
+void OutputBuffer::Write(std::string_view text) {
+	if (text.size() > BUFFER_SIZE - size_) {
+		Flush();
+		if (text.size() >= BUFFER_SIZE) {
+			// длинный текст передаётся в поток без копирования
+			output_.write(text.data(), static_cast<std::streamsize>(text.size()));
+			return;
+		}
+	}
+	std::memcpy(data_.get() + size_, text.data(), text.size());
+	size_ += text.size();
+}
+
+void OutputBuffer::Write(int value) {
+	char buffer[format::NUMBER_SIZE];
+	Write({buffer, static_cast<size_t>(format::WriteNumber(buffer, value) - buffer)});
+}
+
+void OutputBuffer::Write(double value) {
+	char buffer[format::NUMBER_SIZE];
+	Write({buffer, static_cast<size_t>(format::WriteNumber(buffer, value) - buffer)});
+}
+
+void OutputBuffer::Fill(char c, size_t count) {
+	while (count > BUFFER_SIZE - size_) {
+		const size_t part = BUFFER_SIZE - size_;
+		std::memset(data_.get() + size_, c, part);
+		size_ = BUFFER_SIZE;
+		count -= part;
+		Flush();
+	}
+	std::memset(data_.get() + size_, c, count);
+	size_ += count;
+}
+
+void OutputBuffer::Flush() {
+	if (size_ != 0) {
+		output_.write(data_.get(), static_cast<std::streamsize>(size_));
+		size_ = 0;
+	}
+}
+
+void Printer::StartDict() {
+	BeforeValue();
+	out_.Put('{');
+	stack_.push_back({true, true});
+}
+
+void Printer::EndDict() {
+	Close('}');
+}
+
+void Printer::StartArray() {
+	BeforeValue();
+	out_.Put('[');
+	stack_.push_back({false, true});
+}
+
+void Printer::EndArray() {
+	Close(']');
+}
+
+void Printer::Key(std::string_view key, bool) {
+	Separate();
+	PrintString(key, out_);
+	out_.Write(compact_ ? ":"sv : ": "sv);
+	after_key_ = true;
+}
+
+void Printer::String(std::string_view value, bool) {
+	BeforeValue();
+	PrintString(value, out_);
+	FlushIfComplete();
+}
+
+void Printer::Value(Node value) {
+	BeforeValue();
+	PrintNode(value, PrintContext{out_, 4, static_cast<int>(stack_.size()) * 4, compact_});
+	FlushIfComplete();
+}
+
+// Значение словаря выводится сразу за ключом, элемент массива - с новой строки
+void Printer::BeforeValue() {
+	if (stack_.empty() || std::exchange(after_key_, false)) {
+		return;
+	}
+	Separate();
+}
+
+void Printer::Separate() {
+	Level& level = stack_.back();
+	if (!level.empty) {
+		out_.Put(',');
+	}
+	level.empty = false;
+	NewLine();
+}
+
+void Printer::NewLine() {
+	PrintContext{out_, 4, static_cast<int>(stack_.size()) * 4, compact_}.PrintLineBreak();
+}
+
+// Пустые массив и словарь Print выводит с пустой строкой внутри
+void Printer::Close(char bracket) {
+	const bool empty = stack_.back().empty;
+	stack_.pop_back();
+	if (empty && !compact_) {
+		out_.Put('\n');
+	}
+	NewLine();
+	out_.Put(bracket);
+	FlushIfComplete();
+}
+
+void Printer::FlushIfComplete() {
+	if (stack_.empty()) {
+		out_.Flush();
+	}
 }
 
-void Print(const Document& doc, std::ostream& output) {
-	PrintNode(doc.GetRoot(), PrintContext{output});
+void Print(const Document& doc, std::ostream& output, bool compact) {
+	OutputBuffer buffer(output);
+	PrintNode(doc.GetRoot(), PrintContext{buffer, 4, 0, compact});
 }
 
 }// namespace json
@@ -1,41 +1,111 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+class Dict;
+using Array = std::pmr::vector<Node>;
 
 class ParsingError : public std::runtime_error {
 public:
 	using runtime_error::runtime_error;
 };
 
-class Node final
-	: private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+// Узел занимает 16 байт: значение и тип. Строка до 14 байт хранится внутри узла, длиннее - в куче
+// либо как ссылка на текст документа, из которого она прочитана (если в ней нет escape-последовательностей).
+// Узел со ссылкой действителен, пока жив Document. Массив и словарь лежат в куче.
+// Память массива, словаря и копии строки выделяется из memory_resource: массив и словарь берут его
+// у своего аллокатора, строке он передаётся явно. Копия узла, как у контейнеров std::pmr,
+// размещается в ресурсе по умолчанию, перемещение сохраняет ресурс.
+class Node final {
 public:
-	using variant::variant;
-	using Value = variant;
+	// Значение в виде variant для json::Builder
+	using Value = std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, std::string_view>;
+
+	Node() = default;
+	Node(std::nullptr_t) {
+	}
+	Node(Array value);
+	Node(Dict value);
+	Node(bool value)
+		: type_(Type::BOOL) {
+		Store(value);
+	}
+	Node(int value)
+		: type_(Type::INT) {
+		Store(value);
+	}
+	Node(double value)
+		: type_(Type::DOUBLE) {
+		Store(value);
+	}
+	// копия строки
+	Node(const std::string& value) {
+		AssignString(value, false);
+	}
+	Node(const char* value) {
+		AssignString(value, false);
+	}
+	Node(std::string_view value) {
+		AssignString(value, false);
+	}
+	// Ссылка на строку, которая должна пережить узел (короткая строка копируется).
+	// Так NodeBuilder хранит строки документа без escape-последовательностей
+	static Node View(std::string_view value) {
+		Node node;
+		node.AssignString(value, true);
+		return node;
+	}
+	// копия строки в resource
+	Node(std::string_view value, std::pmr::memory_resource* resource) {
+		AssignString(value, false, resource);
+	}
+
+	Node(const Node& other);
+	Node(Node&& other) noexcept {
+		std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+		type_ = std::exchange(other.type_, Type::NUL);
+	}
+	Node& operator=(const Node& other) {
+		if (this != &other) {
+			Node copy(other);
+			Swap(copy);
+		}
+		return *this;
+	}
+	Node& operator=(Node&& other) noexcept {
+		Node moved(std::move(other));
+		Swap(moved);
+		return *this;
+	}
+	~Node();
 
 	bool IsInt() const {
-		return std::holds_alternative<int>(*this);
+		return type_ == Type::INT;
 	}
 	int AsInt() const {
 		using namespace std::literals;
 		if (!IsInt()) {
 			throw std::logic_error("Not an int"s);
 		}
-		return std::get<int>(*this);
+		return Load<int>();
 	}
 
 	bool IsPureDouble() const {
-		return std::holds_alternative<double>(*this);
+		return type_ == Type::DOUBLE;
 	}
 	bool IsDouble() const {
 		return IsInt() || IsPureDouble();
@@ -45,11 +115,11 @@ public:
 		if (!IsDouble()) {
 			throw std::logic_error("Not a double"s);
 		}
-		return IsPureDouble() ? std::get<double>(*this) : AsInt();
+		return IsPureDouble() ? Load<double>() : AsInt();
 	}
 
 	bool IsBool() const {
-		return std::holds_alternative<bool>(*this);
+		return type_ == Type::BOOL;
 	}
 	bool AsBool() const {
 		using namespace std::literals;
@@ -57,15 +127,15 @@ public:
 			throw std::logic_error("Not a bool"s);
 		}
 
-		return std::get<bool>(*this);
+		return Load<bool>();
 	}
 
 	bool IsNull() const {
-		return std::holds_alternative<std::nullptr_t>(*this);
+		return type_ == Type::NUL;
 	}
 
 	bool IsArray() const {
-		return std::holds_alternative<Array>(*this);
+		return type_ == Type::ARRAY;
 	}
 	const Array& AsArray() const {
 		using namespace std::literals;
@@ -73,23 +143,26 @@ public:
 			throw std::logic_error("Not an array"s);
 		}
 
-		return std::get<Array>(*this);
+		return *Load<const Array*>();
 	}
 
 	bool IsString() const {
-		return std::holds_alternative<std::string>(*this);
+		return type_ == Type::SHORT_STRING || type_ == Type::STRING || type_ == Type::STRING_VIEW;
 	}
-	const std::string& AsString() const {
+	// Короткая строка лежит внутри узла: ссылка действительна, пока узел не перемещён
+	std::string_view AsString() const {
 		using namespace std::literals;
-		if (!IsString()) {
-			throw std::logic_error("Not a string"s);
+		if (type_ == Type::SHORT_STRING) {
+			return {bytes_, static_cast<unsigned char>(bytes_[SHORT_SIZE_OFFSET])};
 		}
-
-		return std::get<std::string>(*this);
+		if (type_ == Type::STRING || type_ == Type::STRING_VIEW) {
+			return {Load<const char*>(), Load<uint32_t>(SIZE_OFFSET)};
+		}
+		throw std::logic_error("Not a string"s);
 	}
 
 	bool IsDict() const {
-		return std::holds_alternative<Dict>(*this);
+		return type_ == Type::DICT;
 	}
 	const Dict& AsDict() const {
 		using namespace std::literals;
@@ -97,15 +170,40 @@ public:
 			throw std::logic_error("Not a dict"s);
 		}
 
-		return std::get<Dict>(*this);
+		return *Load<const Dict*>();
 	}
 
-	bool operator==(const Node& rhs) const {
-		return GetValue() == rhs.GetValue();
+	bool operator==(const Node& rhs) const;
+
+private:
+	enum class Type : uint8_t { NUL, BOOL, INT, DOUBLE, ARRAY, DICT, SHORT_STRING, STRING, STRING_VIEW };
+
+	static constexpr size_t SIZE_OFFSET = 8;
+	static constexpr size_t SHORT_SIZE_OFFSET = 14;
+
+	// Символы короткой строки (байты 0-13) и её длина (байт 14) либо значение или указатель (байты 0-7)
+	// и длина строки (байты 8-11)
+	alignas(8) char bytes_[15] = {};
+	Type type_ = Type::NUL;
+
+	template <typename T>
+	T Load(size_t offset = 0) const {
+		T value;
+		std::memcpy(&value, bytes_ + offset, sizeof(T));
+		return value;
+	}
+	template <typename T>
+	void Store(T value, size_t offset = 0) {
+		std::memcpy(bytes_ + offset, &value, sizeof(T));
 	}
 
-	const Value& GetValue() const {
-		return *this;
+	void AssignString(std::string_view value, bool view, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	void Swap(Node& other) noexcept {
+		char bytes[sizeof(bytes_)];
+		std::memcpy(bytes, bytes_, sizeof(bytes_));
+		std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+		std::memcpy(other.bytes_, bytes, sizeof(bytes_));
+		std::swap(type_, other.type_);
 	}
 };
 
@@ -113,17 +211,127 @@ inline bool operator!=(const Node& lhs, const Node& rhs) {
 	return !(lhs == rhs);
 }
 
+// Ключ словаря хранится так же, как строковый узел: копией, а созданный View - ссылкой (короткий копируется)
+class DictKey {
+public:
+	DictKey(std::string_view key)
+		: key_(key) {
+	}
+	DictKey(const std::string& key)
+		: key_(key) {
+	}
+	DictKey(const char* key)
+		: key_(key) {
+	}
+	DictKey(std::string_view key, std::pmr::memory_resource* resource)
+		: key_(key, resource) {
+	}
+	static DictKey View(std::string_view key) {
+		return DictKey(Node::View(key));
+	}
+
+	std::string_view View() const {
+		return key_.AsString();
+	}
+	operator std::string_view() const {
+		return View();
+	}
+
+private:
+	explicit DictKey(Node key)
+		: key_(std::move(key)) {
+	}
+
+	Node key_;
+};
+
+// Словарь - отсортированный по ключу вектор пар: небольшие словари просматриваются подряд,
+// большие - двоичным поиском
+class Dict {
+public:
+	using value_type = std::pair<DictKey, Node>;
+	using Entries = std::pmr::vector<value_type>;
+	using const_iterator = Entries::const_iterator;
+	using allocator_type = Entries::allocator_type;
+
+	Dict() = default;
+	// Пары в произвольном порядке; из пар с одинаковым ключом остаётся первая, как при вставке в std::map
+	explicit Dict(Entries entries);
+
+	allocator_type get_allocator() const {
+		return entries_.get_allocator();
+	}
+
+	const_iterator begin() const {
+		return entries_.begin();
+	}
+	const_iterator end() const {
+		return entries_.end();
+	}
+	size_t size() const {
+		return entries_.size();
+	}
+	bool empty() const {
+		return entries_.empty();
+	}
+
+	const_iterator find(std::string_view key) const;
+	size_t count(std::string_view key) const {
+		return find(key) != end() ? 1 : 0;
+	}
+	const Node& at(std::string_view key) const;
+
+	// Существующий ключ не заменяется
+	std::pair<const_iterator, bool> emplace(DictKey key, Node value);
+
+	bool operator==(const Dict& rhs) const;
+
+private:
+	Entries entries_;
+};
+
+// Текст документа целиком в памяти: отображённый в память файл или прочитанное содержимое потока
+class Buffer {
+public:
+	static std::shared_ptr<const Buffer> MapFile(const std::string& path);
+	static std::shared_ptr<const Buffer> Read(std::istream& input);
+	static std::shared_ptr<const Buffer> FromString(std::string text);
+
+	Buffer(const Buffer&) = delete;
+	Buffer& operator=(const Buffer&) = delete;
+	~Buffer();
+
+	std::string_view Text() const {
+		return text_;
+	}
+
+private:
+	Buffer() = default;
+
+	std::string_view text_;
+	std::string storage_;
+	void* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+};
+
 class Document {
 public:
 	explicit Document(Node root)
 		: root_(std::move(root)) {
 	}
+	Document(Node root, std::shared_ptr<const Buffer> buffer, std::shared_ptr<std::pmr::memory_resource> arena = nullptr)
+		: arena_(std::move(arena)), buffer_(std::move(buffer)), root_(std::move(root)) {
+	}
 
 	const Node& GetRoot() const {
 		return root_;
 	}
 
 private:
+	// память узлов; объявлена первой, чтобы освобождаться после них
+	std::shared_ptr<std::pmr::memory_resource> arena_;
+	// текст, на который ссылаются строковые узлы
+	std::shared_ptr<const Buffer> buffer_;
 	Node root_;
 };
 
@@ -135,8 +343,143 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
 	return !(lhs == rhs);
 }
 
+// Получатель событий потокового разбора (json::Parse). Скаляры, кроме строк, приходят в Value.
+// Строка в Key и String при persistent ссылается на текст буфера и живёт вместе с ним,
+// иначе (в ней были escape-последовательности) она действительна только до возврата из вызова.
+class Handler {
+public:
+	virtual ~Handler() = default;
+
+	virtual void StartDict() = 0;
+	virtual void EndDict() = 0;
+	virtual void StartArray() = 0;
+	virtual void EndArray() = 0;
+	virtual void Key(std::string_view key, bool persistent) = 0;
+	virtual void String(std::string_view value, bool persistent) = 0;
+	virtual void Value(Node value) = 0;
+};
+
+// Собирает Node из событий разбора. Отдельный NodeBuilder может собрать часть документа,
+// события для которой ему передаёт другой обработчик.
+class NodeBuilder final : public Handler {
+public:
+	explicit NodeBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: resource_(resource) {
+	}
+
+	void StartDict() override;
+	void EndDict() override;
+	void StartArray() override;
+	void EndArray() override;
+	void Key(std::string_view key, bool persistent) override;
+	void String(std::string_view value, bool persistent) override;
+	void Value(Node value) override;
+
+	// true, когда собран очередной узел верхнего уровня
+	bool IsComplete() const {
+		return stack_.empty() && root_.has_value();
+	}
+	Node Extract();
+
+private:
+	struct Frame {
+		bool is_dict;
+		Array array;
+		Dict::Entries entries;
+		std::optional<DictKey> key;
+		// ключи большого словаря для поиска повторов
+		std::unordered_set<std::string> keys;
+	};
+
+	std::pmr::memory_resource* resource_;
+	std::vector<Frame> stack_;
+	std::optional<Node> root_;
+
+	void Add(Node value);
+};
+
+// Буфер вывода: текст собирается в памяти и передаётся в поток частями по BUFFER_SIZE байт.
+// Числа форматируются std::to_chars так же, как их выводит std::ostream.
+class OutputBuffer {
+public:
+	explicit OutputBuffer(std::ostream& output)
+		: output_(output), data_(new char[BUFFER_SIZE]) {
+	}
+	OutputBuffer(const OutputBuffer&) = delete;
+	OutputBuffer& operator=(const OutputBuffer&) = delete;
+	~OutputBuffer() {
+		Flush();
+	}
+
+	void Put(char c) {
+		if (size_ == BUFFER_SIZE) {
+			Flush();
+		}
+		data_[size_++] = c;
+	}
+	void Write(std::string_view text);
+	void Write(int value);
+	void Write(double value);
+	// count копий символа c
+	void Fill(char c, size_t count);
+	void Flush();
+
+private:
+	static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+	std::ostream& output_;
+	std::unique_ptr<char[]> data_;
+	size_t size_ = 0;
+};
+
+// Выводит события сразу в поток в том же виде, что и Print, но ключи словаря - в порядке поступления.
+// Хранит только стек открытых массивов и словарей. В режиме compact значение занимает одну строку
+// без пробелов. Массивы и словари приходят событиями, в Value - только простые значения.
+class Printer final : public Handler {
+public:
+	explicit Printer(std::ostream& output, bool compact = false)
+		: out_(output), compact_(compact) {
+	}
+
+	void StartDict() override;
+	void EndDict() override;
+	void StartArray() override;
+	void EndArray() override;
+	void Key(std::string_view key, bool persistent) override;
+	void String(std::string_view value, bool persistent) override;
+	void Value(Node value) override;
+
+private:
+	struct Level {
+		bool is_dict;
+		bool empty;
+	};
+
+	// значение верхнего уровня передаётся в поток, как только завершено
+	OutputBuffer out_;
+	bool compact_;
+	std::vector<Level> stack_;
+	bool after_key_ = false;
+
+	void BeforeValue();
+	void Separate();
+	void NewLine();
+	void Close(char bracket);
+	void FlushIfComplete();
+};
+
+// Разбирает весь текст буфера, передавая события в handler
+void Parse(const Buffer& buffer, Handler& handler);
+
+// Узлы документа размещаются в его собственной арене (monotonic_buffer_resource) и освобождаются вместе с ней
 Document Load(std::istream& input);
+Document Load(std::shared_ptr<const Buffer> buffer);
+// Узлы размещаются в resource, который должен пережить документ
+Document Load(std::shared_ptr<const Buffer> buffer, std::pmr::memory_resource* resource);
+// Разбирает файл, отображённый в память, без промежуточного копирования
+Document LoadFile(const std::string& path);
 
-void Print(const Document& doc, std::ostream& output);
+// В режиме compact документ выводится одной строкой без пробелов
+void Print(const Document& doc, std::ostream& output, bool compact = false);
 
 }// namespace json
@@ -1,5 +1,7 @@
 #include "json_builder.h"
 
+#include <iterator>
+
 namespace json {
 
 Builder::ValueAfterKeyItemContext Builder::KeyItemContext::Value(Node::Value item) {
@@ -13,14 +15,17 @@ Builder::ValueAfterKeyItemContext Builder::KeyItemContext::Value(Node::Value ite
 			builder_.last_states_.pop_back();
 		}
 	}
-	Node new_node = std::visit([](auto val){ return Node(val); }, item);
-	builder_.nodes_stack_.push_back(new_node);
+	builder_.nodes_stack_.push_back(builder_.MakeNode(std::move(item)));
 	return builder_;
 }
 
 Builder::ValueAfterValueItemContext Builder::ArrayItemContext::Value(Node::Value item) {
-	Node new_node = std::visit([](auto val){ return Node(val); }, item);
-	builder_.nodes_stack_.push_back(new_node);
+	builder_.nodes_stack_.push_back(builder_.MakeNode(std::move(item)));
+	return builder_;
+}
+
+Builder::ValueAfterValueItemContext Builder::ValueAfterValueItemContext::Value(Node::Value item) {
+	builder_.nodes_stack_.push_back(builder_.MakeNode(std::move(item)));
 	return builder_;
 }
 
@@ -37,7 +42,7 @@ Builder::ArrayItemContext  Builder::StartArray() {
 		}
 	}
 	Node node{};
-	nodes_stack_.push_back(move(node));
+	nodes_stack_.push_back(std::move(node));
 	last_states_.push_back(STATE::array);
 	pos_.push_back(nodes_stack_.size() - 1);
 	return *this;
@@ -54,20 +59,20 @@ Builder::DictItemContext Builder::StartDict() {
 		}
 	}
 	Node node{};
-	nodes_stack_.push_back(move(node));
+	nodes_stack_.push_back(std::move(node));
 	last_states_.push_back(STATE::dict);
 	pos_.push_back(nodes_stack_.size() - 1);
 	return *this;
 }
 
-Builder::KeyItemContext Builder::Key(std::string key)  {
+Builder::KeyItemContext Builder::Key(std::string_view key)  {
 	if (last_states_.empty()) {
 		throw std::logic_error("big fucking error");
 	}
 	if ((last_states_.back() == STATE::key) || (last_states_.back() != STATE::dict) ) {
 		throw std::logic_error("key after key");
 	}
-	nodes_stack_.emplace_back(key);
+	keys_.emplace_back(key, resource_);
 	last_states_.push_back(STATE::key);
 	return *this;
 }
@@ -82,43 +87,35 @@ Builder::FunctionRelocation  Builder::Value(Node::Value item) {
 			last_states_.pop_back();
 		}
 	}
-	Node new_node = std::visit([](auto val){ return Node(val); }, item);
-	nodes_stack_.push_back(new_node);
+	nodes_stack_.push_back(MakeNode(std::move(item)));
 	return *this;
 }
 
 Builder::FunctionRelocation  Builder::EndArray() {
 	(!last_states_.empty() && last_states_.back() == STATE::array) ? last_states_.pop_back() : throw std::logic_error("test array");
-	Array something;
-	for (int i = nodes_stack_.size() - 1; i >= 0; --i) {
-		if (i == pos_.back()) { //nodes_stack_[i].GetValue().index() == 0
-			pos_.pop_back();
-			nodes_stack_.resize(i);
-			break;
-		} else {
-			something.push_back(nodes_stack_[i]);
-		}
-	}
-	reverse(something.begin(), something.end());
-	nodes_stack_.push_back(move(something));
+	// элементы лежат в стеке за пустым узлом, который занимает место массива
+	const size_t begin = pos_.back() + 1;
+	pos_.pop_back();
+	Array something(std::make_move_iterator(nodes_stack_.begin() + begin), std::make_move_iterator(nodes_stack_.end()), resource_);
+	nodes_stack_.resize(begin);
+	nodes_stack_.back() = Node(std::move(something));
 	return *this;
 }
 
 Builder::FunctionRelocation  Builder::EndDict() {
 	(!last_states_.empty() && last_states_.back() == STATE::dict) ? last_states_.pop_back() : throw std::logic_error("test dict");
-	Dict something{};
-	for (int i = nodes_stack_.size() - 1; i >= 0; --i) {
-
-		if (i == pos_.back()) { //nodes_stack_[i].GetValue().index() == 0
-			pos_.pop_back();
-			nodes_stack_.resize(i);
-			break;
-		} else {
-			something.insert({nodes_stack_[i-1].AsString(), nodes_stack_[i] });
-			--i;
-		}
+	const size_t begin = pos_.back() + 1;
+	pos_.pop_back();
+	const size_t count = nodes_stack_.size() - begin;
+	Dict::Entries something(resource_);
+	something.reserve(count);
+	// пары добавляются с конца: из повторов ключа Dict оставляет первую, то есть заданную последней
+	for (size_t i = count; i > 0; --i) {
+		something.emplace_back(std::move(keys_[keys_.size() - count + i - 1]), std::move(nodes_stack_[begin + i - 1]));
 	}
-	nodes_stack_.emplace_back(move(something));
+	keys_.erase(keys_.end() - count, keys_.end());
+	nodes_stack_.resize(begin);
+	nodes_stack_.back() = Node(Dict(std::move(something)));
 	return *this;
 }
 
@@ -132,7 +129,21 @@ json::Node Builder::Build() {
 	if (nodes_stack_.empty() || nodes_stack_.size() > 1) {
 		throw std::logic_error("build not complete");
 	}
-	return *nodes_stack_.begin();
+	// строитель одноразовый: корень перемещается, а не копируется в ресурс по умолчанию
+	return std::move(nodes_stack_.front());
+}
+
+Node Builder::MakeNode(Node::Value item) const {
+	// строки копируются в resource_: string_view может ссылаться на временную строку вызывающего
+	if (const std::string* value = std::get_if<std::string>(&item)) {
+		return Node(*value, resource_);
+	}
+	if (const std::string_view* value = std::get_if<std::string_view>(&item)) {
+		return Node(*value, resource_);
+	}
+	return std::visit([](auto&& value) {
+		return Node(std::move(value));
+	}, std::move(item));
 }
 
 }// namespace json
@@ -6,6 +6,8 @@
 #include <iostream>
 namespace json {
 
+// Собирает Node вызовами в цепочку. Ответы каталога выводит json::Writer, Builder остаётся библиотечным API;
+// выделения памяти при построении ответа измеряет tools/json_builder_bench
 class Builder {
 	class DictItemContext;
 	class ArrayItemContext;
@@ -23,9 +25,9 @@ class Builder {
 			return builder_.StartDict();
 		}
 		FunctionRelocation Value(Node::Value item) {
-			return builder_.Value(item);
+			return builder_.Value(std::move(item));
 		}
-		KeyItemContext Key(std::string key) {
+		KeyItemContext Key(std::string_view key) {
 			return builder_.Key(key);
 		}
 		ArrayItemContext StartArray() {
@@ -63,7 +65,7 @@ class Builder {
 				FunctionRelocation(link) {
 		}
 
-		KeyItemContext Key(std::string key) = delete;
+		KeyItemContext Key(std::string_view key) = delete;
 		FunctionRelocation EndDict() = delete;
 		json::Node Build() = delete;
 		ValueAfterValueItemContext Value(Node::Value item);
@@ -75,7 +77,7 @@ class Builder {
 				FunctionRelocation(link) {
 		}
 
-		KeyItemContext Key(std::string key) = delete;
+		KeyItemContext Key(std::string_view key) = delete;
 		FunctionRelocation EndDict() = delete;
 		FunctionRelocation EndArray() = delete;
 		json::Node Build() = delete;
@@ -101,7 +103,7 @@ class Builder {
 				FunctionRelocation(link) {
 		}
 		ValueAfterValueItemContext Value(Node::Value item);
-		KeyItemContext Key(std::string key) = delete;
+		KeyItemContext Key(std::string_view key) = delete;
 		FunctionRelocation EndDict() = delete;
 		json::Node Build() = delete;
 	};
@@ -113,18 +115,29 @@ class Builder {
 	};
 
 public:
+	// Массивы, словари и копии строк результата размещаются в resource. Узлы не копируются:
+	// значение перемещается в стек, а из него - в массив или словарь и в результат Build
+	explicit Builder(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: resource_(resource) {
+	}
+
 	ArrayItemContext StartArray();
 	DictItemContext StartDict();
-	KeyItemContext Key(std::string key);
+	KeyItemContext Key(std::string_view key);
 	FunctionRelocation Value(Node::Value item);
 	FunctionRelocation EndArray();
 	FunctionRelocation EndDict();
 	json::Node Build();
 
 private:
-	std::vector<int> pos_;
+	std::pmr::memory_resource* resource_;
+	std::vector<size_t> pos_;
 	std::vector<STATE> last_states_;
 	std::vector<Node> nodes_stack_;
+	// ключи открытых словарей, по одному на каждое значение словаря в nodes_stack_
+	std::vector<DictKey> keys_;
+
+	Node MakeNode(Node::Value item) const;
 };
 
 }// namespace json
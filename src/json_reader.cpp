@@ -5,28 +5,22 @@ namespace input {
 
 using namespace std::literals;
 
-void ParseRoute(TransportCatalogue& transport_catalog, const json::Node* bus_node) {
-	std::vector<std::string_view> stops_list;
-	if (!bus_node->AsDict().at("stops").AsArray().empty()) {
-		stops_list.reserve( bus_node->AsDict().at("stops").AsArray().size() + 1);
-		for (const json::Node& stop : bus_node->AsDict().at("stops").AsArray()) {
-			stops_list.push_back(stop.AsString());
-		}
-	}
-	transport_catalog.AddRoute(bus_node->AsDict().at("name").AsString(), bus_node->AsDict().at("is_roundtrip").AsBool(), move(stops_list));
-}
-
-StopData ParseStop(TransportCatalogue& transport_catalog, const json::Node* stop_node) {
-	StopData distances_reserved;
-	double latitude = stop_node->AsDict().at("latitude").AsDouble();
+geo::Coordinates MakeCoordinates(double latitude, double longitude) {
 	if (latitude < 0) {
 		latitude *= -1;
 	}
-	double longitude = stop_node->AsDict().at("longitude").AsDouble();
 	if (longitude < 0) {
 		longitude *= -1;
 	}
-	transport_catalog.AddStop(stop_node->AsDict().at("name").AsString(), {latitude, longitude});
+	return {latitude, longitude};
+}
+
+geo::Coordinates ParseCoordinates(const json::Node* node) {
+	return MakeCoordinates(node->AsDict().at("latitude").AsDouble(), node->AsDict().at("longitude").AsDouble());
+}
+
+StopData ParseStopDistances(const json::Node* stop_node) {
+	StopData distances_reserved;
 	if (!stop_node->AsDict().at("road_distances").AsDict().empty()) {
 		std::vector<std::pair<std::string_view, int>> distance_temp;
 		distance_temp.reserve(stop_node->AsDict().at("road_distances").AsDict().size() + 1);
@@ -86,70 +80,436 @@ void ParseMap(svg::output::MapRenderer& render, const json::Node* settings_node)
 }
 
 
-void FillData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, std::istream& input) {
-	json::Document doc = json::Load(input);
-	if (doc.GetRoot().IsDict()) {
-		std::map<std::string_view, std::vector<std::pair<std::string_view, int>>> distances_reserved;
-		if (!doc.GetRoot().AsDict().at("serialization_settings").AsDict().empty()) {
-			handler.AddSerializationFilename(doc.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString());
+void ParseNearbyRequest(RequestHandler& handler, const json::Node* request_node) {
+	const json::Dict& request = request_node->AsDict();
+	std::optional<double> radius;
+	if (auto iter = request.find("radius"); iter != request.end()) {
+		radius = iter->second.AsDouble();
+	}
+	std::optional<int> count;
+	if (auto iter = request.find("k"); iter != request.end()) {
+		count = iter->second.AsInt();
+	}
+	if (!radius && !count) {
+		throw std::invalid_argument("Nearby request requires radius or k");
+	}
+	handler.AddNearbyRequest(request.at("id").AsInt(), ParseCoordinates(request_node), radius, count);
+}
+
+void ParseStopSearchRequest(RequestHandler& handler, const json::Node* request_node) {
+	const json::Dict& request = request_node->AsDict();
+	// без k отдаются первые 10 подсказок
+	int count = 10;
+	if (auto iter = request.find("k"); iter != request.end()) {
+		count = iter->second.AsInt();
+	}
+	bool fuzzy = false;
+	if (auto iter = request.find("fuzzy"); iter != request.end()) {
+		fuzzy = iter->second.AsBool();
+	}
+	handler.AddStopSearchRequest(request.at("id").AsInt(), request.at("prefix").AsString(), count, fuzzy);
+}
+
+void ParseMapTileRequest(RequestHandler& handler, const json::Node* request_node) {
+	const json::Dict& request = request_node->AsDict();
+	TileArea area;
+	if (request.count("zoom")) {
+		area.zoom = request.at("zoom").AsInt();
+		area.x = request.at("x").AsInt();
+		area.y = request.at("y").AsInt();
+		if (area.zoom < 0 || area.zoom > 30 || area.x < 0 || area.y < 0 || area.x >= (1 << area.zoom) || area.y >= (1 << area.zoom)) {
+			throw std::invalid_argument("MapTile request requires 0 <= zoom <= 30 and 0 <= x, y < 2^zoom");
 		}
-		if (!doc.GetRoot().AsDict().at("base_requests").AsArray().empty()) {
-			std::vector<const json::Node*> Buses_list;
-			for (auto& item : doc.GetRoot().AsDict().at("base_requests").AsArray()) {
-				if (item.AsDict().at("type").AsString() == "Stop") {
-					distances_reserved.merge(ParseStop(transport_catalog, &item));
-				}
-				if (item.AsDict().at("type").AsString() == "Bus") {
-					Buses_list.push_back(&item);
-				}
+	} else {
+		const geo::Coordinates first = MakeCoordinates(request.at("min_latitude").AsDouble(), request.at("min_longitude").AsDouble());
+		const geo::Coordinates second = MakeCoordinates(request.at("max_latitude").AsDouble(), request.at("max_longitude").AsDouble());
+		// MakeCoordinates меняет знак, поэтому углы упорядочиваются заново
+		area.bounds = {{std::min(first.lat, second.lat), std::min(first.lng, second.lng)},
+				{std::max(first.lat, second.lat), std::max(first.lng, second.lng)}};
+		if (area.bounds->first.lat == area.bounds->second.lat || area.bounds->first.lng == area.bounds->second.lng) {
+			throw std::invalid_argument("MapTile bounds must not be empty");
+		}
+	}
+	handler.AddMapTileRequest(request.at("id").AsInt(), area);
+}
+
+void ParseBaseSettings(svg::output::MapRenderer& render, RequestHandler& handler, const json::Dict& root) {
+	if (!root.at("serialization_settings").AsDict().empty()) {
+		const json::Dict& serialization_settings = root.at("serialization_settings").AsDict();
+		handler.AddSerializationFilename(serialization_settings.at("file").AsString());
+		if (serialization_settings.count("shards")) {
+			handler.SetShardsCount(serialization_settings.at("shards").AsInt());
+		}
+		if (serialization_settings.count("compact_coordinates")) {
+			handler.SetCompactCoordinates(serialization_settings.at("compact_coordinates").AsBool());
+		}
+	}
+	if (!root.at("render_settings").AsDict().empty()) {
+		ParseMap(render, &root.at("render_settings"));
+	}
+	if (!root.at("routing_settings").AsDict().empty()) {
+		// граф маршрутов строится при загрузке базы, в make_base нужны только настройки
+		handler.GetTransportRouter().SetRoutingSettings(
+				root.at("routing_settings").AsDict().at("bus_velocity").AsInt(),
+				root.at("routing_settings").AsDict().at("bus_wait_time").AsInt()
+				);
+	}
+}
+
+namespace {
+
+// Потоковый разбор make_base: запросы из base_requests раскладываются в BulkData по мере чтения,
+// без узлов json::Node, остальные разделы документа (настройки) собираются в settings обычными узлами.
+// Автобус может идти раньше своих остановок, поэтому записи копятся и загружаются разом через BulkLoad.
+class BaseRequestsReader final : public json::Handler {
+public:
+	BaseRequestsReader(BulkData& data, json::Dict& settings)
+		: data_(data), settings_(settings) {
+	}
+
+	void StartDict() override {
+		if (skip_depth_ > 0) {
+			++skip_depth_;
+		} else if (delegating_) {
+			builder_.StartDict();
+		} else if (depth_ == 0 || (depth_ == 2 && in_base_requests_) || (depth_ == 3 && field_ == Field::DISTANCES)) {
+			if (++depth_ == 3) {
+				record_ = {};
+				stops_.clear();
+				distances_.clear();
 			}
-			if (!Buses_list.empty()) {
-				for (auto& node : Buses_list) {
-					ParseRoute(transport_catalog, node);
-				}
+		} else {
+			skip_depth_ = 1;
+		}
+	}
+	void EndDict() override {
+		if (skip_depth_ > 0) {
+			--skip_depth_;
+		} else if (delegating_) {
+			builder_.EndDict();
+			CheckSection();
+		} else {
+			if (depth_ == 3) {
+				AddRecord();
 			}
+			--depth_;
 		}
-		if (!distances_reserved.empty()) {
-			transport_catalog.AddDistances(distances_reserved);
+	}
+	void StartArray() override {
+		if (skip_depth_ > 0) {
+			++skip_depth_;
+		} else if (delegating_) {
+			builder_.StartArray();
+		} else if (depth_ == 0) {
+			throw std::invalid_argument("Invalid input struct");
+		} else if ((depth_ == 1 && in_base_requests_) || (depth_ == 3 && field_ == Field::STOPS)) {
+			++depth_;
+		} else {
+			skip_depth_ = 1;
 		}
-		if (!doc.GetRoot().AsDict().at("render_settings").AsDict().empty()) {
-			ParseMap(render, &doc.GetRoot().AsDict().at("render_settings"));
+	}
+	void EndArray() override {
+		if (skip_depth_ > 0) {
+			--skip_depth_;
+		} else if (delegating_) {
+			builder_.EndArray();
+			CheckSection();
+		} else {
+			--depth_;
 		}
-		if (!doc.GetRoot().AsDict().at("routing_settings").AsDict().empty()) {
-			handler.GetTransportRouter().SetupRouter(
-					transport_catalog,
-					doc.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_velocity").AsInt(),
-					doc.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_wait_time").AsInt()
-					);
+	}
+	void Key(std::string_view key, bool persistent) override {
+		if (skip_depth_ > 0) {
+			return;
 		}
-	} else {
+		if (delegating_) {
+			builder_.Key(key, persistent);
+		} else if (depth_ == 1) {
+			in_base_requests_ = key == "base_requests";
+			if (!in_base_requests_) {
+				section_ = key;
+				delegating_ = true;
+			}
+		} else if (depth_ == 3) {
+			field_ = FindField(key);
+		} else if (depth_ == 4) {
+			distance_to_ = Keep(key, persistent);
+		}
+	}
+	void String(std::string_view value, bool persistent) override {
+		if (skip_depth_ > 0) {
+			return;
+		}
+		if (delegating_) {
+			builder_.String(value, persistent);
+			CheckSection();
+		} else if (depth_ == 0) {
+			throw std::invalid_argument("Invalid input struct");
+		} else if (depth_ == 3) {
+			if (field_ == Field::TYPE) {
+				record_.type = value == "Stop" ? Type::STOP : value == "Bus" ? Type::BUS : Type::OTHER;
+			} else if (field_ == Field::NAME) {
+				record_.name = Keep(value, persistent);
+			}
+		} else if (depth_ == 4 && field_ == Field::STOPS) {
+			stops_.push_back(Keep(value, persistent));
+		}
+	}
+	void Value(json::Node value) override {
+		if (skip_depth_ > 0) {
+			return;
+		}
+		if (delegating_) {
+			builder_.Value(std::move(value));
+			CheckSection();
+		} else if (depth_ == 0) {
+			throw std::invalid_argument("Invalid input struct");
+		} else if (depth_ == 3) {
+			if (field_ == Field::LATITUDE) {
+				record_.latitude = value.AsDouble();
+			} else if (field_ == Field::LONGITUDE) {
+				record_.longitude = value.AsDouble();
+			} else if (field_ == Field::ROUNDTRIP) {
+				record_.is_roundtrip = value.AsBool();
+			}
+		} else if (depth_ == 4 && field_ == Field::DISTANCES) {
+			distances_.emplace_back(distance_to_, value.AsInt());
+		}
+	}
+
+private:
+	enum class Field { NONE, TYPE, NAME, LATITUDE, LONGITUDE, ROUNDTRIP, DISTANCES, STOPS };
+	enum class Type { NONE, STOP, BUS, OTHER };
+
+	struct Record {
+		Type type = Type::NONE;
+		std::string_view name;
+		std::optional<double> latitude;
+		std::optional<double> longitude;
+		std::optional<bool> is_roundtrip;
+	};
+
+	BulkData& data_;
+	json::Dict& settings_;
+	// собирает значение раздела section_ верхнего уровня
+	json::NodeBuilder builder_;
+	std::string section_;
+	bool delegating_ = false;
+	// глубина пропускаемого контейнера с неизвестными полями
+	int skip_depth_ = 0;
+
+	// 1 - корень, 2 - base_requests, 3 - запрос, 4 - road_distances или stops
+	int depth_ = 0;
+	bool in_base_requests_ = false;
+	Field field_ = Field::NONE;
+	Record record_;
+	std::string_view distance_to_;
+	std::vector<std::string_view> stops_;
+	std::vector<std::pair<std::string_view, int>> distances_;
+
+	static Field FindField(std::string_view key) {
+		if (key == "type") {
+			return Field::TYPE;
+		} else if (key == "name") {
+			return Field::NAME;
+		} else if (key == "latitude") {
+			return Field::LATITUDE;
+		} else if (key == "longitude") {
+			return Field::LONGITUDE;
+		} else if (key == "is_roundtrip") {
+			return Field::ROUNDTRIP;
+		} else if (key == "road_distances") {
+			return Field::DISTANCES;
+		} else if (key == "stops") {
+			return Field::STOPS;
+		}
+		return Field::NONE;
+	}
+
+	// Строка с escape-последовательностями живёт только до возврата из события, её копия хранится в data_
+	std::string_view Keep(std::string_view value, bool persistent) {
+		if (persistent) {
+			return value;
+		}
+		return data_.strings.emplace_back(value);
+	}
+
+	void CheckSection() {
+		if (builder_.IsComplete()) {
+			settings_.emplace(std::move(section_), builder_.Extract());
+			delegating_ = false;
+		}
+	}
+
+	void AddRecord() {
+		if (record_.type == Type::STOP) {
+			if (!record_.latitude || !record_.longitude) {
+				throw std::invalid_argument("Stop requires latitude and longitude");
+			}
+			const uint32_t stop = static_cast<uint32_t>(data_.stops.size());
+			data_.stops.push_back({record_.name, MakeCoordinates(*record_.latitude, *record_.longitude)});
+			for (const auto& [destination, distance] : distances_) {
+				data_.distances.push_back({stop, destination, distance});
+			}
+		} else if (record_.type == Type::BUS) {
+			if (!record_.is_roundtrip) {
+				throw std::invalid_argument("Bus requires is_roundtrip");
+			}
+			const uint32_t stops_begin = static_cast<uint32_t>(data_.route_stops.size());
+			data_.route_stops.insert(data_.route_stops.end(), stops_.begin(), stops_.end());
+			data_.routes.push_back({record_.name, *record_.is_roundtrip,
+					stops_begin, static_cast<uint32_t>(data_.route_stops.size())});
+		}
+	}
+};
+
+}// namespace
+
+void FillData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, const json::Buffer& buffer) {
+	BulkData data;
+	json::Dict settings;
+	BaseRequestsReader reader(data, settings);
+	json::Parse(buffer, reader);
+	transport_catalog.BulkLoad(data);
+	ParseBaseSettings(render, handler, settings);
+}
+
+BaseChanges FillUpdateData(TransportCatalogue& transport_catalog, RequestHandler& handler, const json::Document& doc) {
+	if (!doc.GetRoot().IsDict()) {
 		throw std::invalid_argument("Invalid input struct");
 	}
+	const json::Dict& root = doc.GetRoot().AsDict();
+	const std::string filename(root.at("serialization_settings").AsDict().at("file").AsString());
+	handler.AddDeserializationFilename(filename);
+	handler.AddSerializationFilename(filename);
+	handler.LoadForUpdate();
+
+	BaseChanges changes;
+	const json::Array empty_list;
+	auto section = [&root, &empty_list](const std::string& name) -> const json::Array& {
+		auto iter = root.find(name);
+		return iter != root.end() ? iter->second.AsArray() : empty_list;
+	};
+	// порядок как в make_base: остановки, затем расстояния и маршруты, в конце удаления
+	StopData distances_reserved;
+	std::vector<const json::Node*> buses_list;
+	for (const json::Node& item : section("base_requests")) {
+		if (item.AsDict().at("type").AsString() == "Stop") {
+			transport_catalog.UpdateStop(item.AsDict().at("name").AsString(), ParseCoordinates(&item));
+			distances_reserved.merge(ParseStopDistances(&item));
+			changes.stops = true;
+		} else if (item.AsDict().at("type").AsString() == "Bus") {
+			buses_list.push_back(&item);
+		}
+	}
+	if (!distances_reserved.empty()) {
+		transport_catalog.AddDistances(distances_reserved);
+		changes.distances = true;
+	}
+	for (const json::Node* bus_node : buses_list) {
+		std::vector<std::string_view> stops_list;
+		for (const json::Node& stop : bus_node->AsDict().at("stops").AsArray()) {
+			stops_list.push_back(stop.AsString());
+		}
+		transport_catalog.UpdateRoute(bus_node->AsDict().at("name").AsString(), bus_node->AsDict().at("is_roundtrip").AsBool(), move(stops_list));
+		changes.buses = true;
+	}
+	std::vector<const json::Node*> stops_to_remove;
+	for (const json::Node& item : section("remove_requests")) {
+		const std::string_view type = item.AsDict().at("type").AsString();
+		if (type == "Bus") {
+			transport_catalog.RemoveRoute(item.AsDict().at("name").AsString());
+			changes.buses = true;
+		} else if (type == "Distance") {
+			transport_catalog.RemoveDistance(item.AsDict().at("from").AsString(), item.AsDict().at("to").AsString());
+			changes.distances = true;
+		} else if (type == "Stop") {
+			stops_to_remove.push_back(&item);
+		}
+	}
+	for (const json::Node* stop_node : stops_to_remove) {
+		transport_catalog.RemoveStop(stop_node->AsDict().at("name").AsString());
+		changes.stops = true;
+	}
+	transport_catalog.BuildStopsIndex();
+	transport_catalog.BuildRoutesDistances();
+	if (changes.stops) {
+		transport_catalog.BuildNamesIndex();
+	}
+	return changes;
 }
 
-void FillRequestsData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, std::istream& input) {
-	json::Document doc = json::Load(input);
+void ParseStatRequest(RequestHandler& handler, const json::Node& item) {
+	if (item.AsDict().at("type").AsString() == "Map") {
+		handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), {}, {});
+	} else if (item.AsDict().at("type").AsString() == "Nearby") {
+		ParseNearbyRequest(handler, &item);
+	} else if (item.AsDict().at("type").AsString() == "StopSearch") {
+		ParseStopSearchRequest(handler, &item);
+	} else if (item.AsDict().at("type").AsString() == "MapTile") {
+		ParseMapTileRequest(handler, &item);
+	} else if (item.AsDict().at("type").AsString() == "Route") {
+		handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), item.AsDict().at("from").AsString(), item.AsDict().at("to").AsString());
+	} else {
+		handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), item.AsDict().at("name").AsString(), {});
+	}
+}
+
+void FillRequestsData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, const json::Document& doc) {
 	if (doc.GetRoot().IsDict()) {
 		if (!doc.GetRoot().AsDict().at("serialization_settings").AsDict().empty()) {
 			handler.AddDeserializationFilename(doc.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString());
 		}
-		if (!doc.GetRoot().AsDict().at("stat_requests").AsArray().empty()) {
-			for (auto& item : doc.GetRoot().AsDict().at("stat_requests").AsArray()) {
-				if (item.AsDict().at("type").AsString() == "Map") {
-					handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), {}, {});
-				} else if (item.AsDict().at("type").AsString() == "Route") {
-					handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), item.AsDict().at("from").AsString(), item.AsDict().at("to").AsString());
-				} else {
-					handler.AddRequest(item.AsDict().at("id").AsInt(), item.AsDict().at("type").AsString(), item.AsDict().at("name").AsString(), {});
-				}
+		if (doc.GetRoot().AsDict().count("output_settings")) {
+			const json::Dict& output_settings = doc.GetRoot().AsDict().at("output_settings").AsDict();
+			if (output_settings.count("compact")) {
+				handler.SetCompactOutput(output_settings.at("compact").AsBool());
 			}
 		}
+		for (const json::Node& item : doc.GetRoot().AsDict().at("stat_requests").AsArray()) {
+			ParseStatRequest(handler, item);
+		}
 	} else {
 		throw std::invalid_argument("Invalid input struct");
 	}
 
 }
 
+void ProcessRequestsStream(RequestHandler& handler, std::istream& input, std::ostream& output) {
+	// узлы строки размещаются в буфере на стеке и освобождаются после ответа на неё
+	std::array<std::byte, 1 << 14> initial_buffer;
+	std::pmr::monotonic_buffer_resource arena(initial_buffer.data(), initial_buffer.size());
+	std::string line;
+	bool loaded = false;
+	while (std::getline(input, line)) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos) {
+			continue;
+		}
+		if (!loaded) {
+			json::Document settings = json::Load(json::Buffer::FromString(line));
+			handler.AddDeserializationFilename(settings.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString());
+			handler.Load();
+			loaded = true;
+			continue;
+		}
+		// некорректная строка не прерывает поток: на неё выводится строка с ошибкой и id запроса, если он прочитан
+		std::optional<int> id;
+		try {
+			json::Document request = json::Load(json::Buffer::FromString(line), &arena);
+			if (const json::Node& root = request.GetRoot(); root.IsDict()) {
+				if (auto iter = root.AsDict().find("id"sv); iter != root.AsDict().end() && iter->second.IsInt()) {
+					id = iter->second.AsInt();
+				}
+			}
+			ParseStatRequest(handler, request.GetRoot());
+		} catch (const std::exception& e) {
+			RequestHandler::PrintErrorLine(output, e.what(), id);
+		}
+		arena.release();
+		handler.PrintResultLines(output);
+	}
+}
+
 }// namespace input
 }// namespace location
 
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <iomanip>
 #include <iostream>
+#include <memory_resource>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -11,6 +15,7 @@
 #include <vector>
 
 #include "json.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "request_handler.h"
 #include "transport_catalogue.h"
@@ -24,18 +29,34 @@ using StopData = std::map<std::string_view, std::vector<std::pair<std::string_vi
 json::Document LoadJSON(const std::string& s);
 std::string Print(const json::Node& node);
 
-StopData ParseStop(TransportCatalogue& transport_catalog, const json::Node* stop_node);
-void ParseRoute(TransportCatalogue& transport_catalog, const json::Node*);
+geo::Coordinates MakeCoordinates(double latitude, double longitude);
+geo::Coordinates ParseCoordinates(const json::Node* node);
+StopData ParseStopDistances(const json::Node* stop_node);
 void ParseMap(TransportCatalogue& transport_catalog, const json::Node* settings_node);
 void ParseRoutingSettings(TransportCatalogue& transport_catalog, const json::Node* bus_node);
 
 std::variant<std::string, std::vector<double>>  DiscernColor(const json::Node* color_node);
 
+void ParseNearbyRequest(RequestHandler& handler, const json::Node* request_node);
+void ParseStopSearchRequest(RequestHandler& handler, const json::Node* request_node);
+void ParseMapTileRequest(RequestHandler& handler, const json::Node* request_node);
+
 void FormRequest(TransportCatalogue& transport_catalog, const json::Node*);
 
 void RequestOutput(TransportCatalogue& transport_catalog, const json::Node*, std::ostream& output);
-void FillData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, std::istream& input);
-void FillRequestsData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, std::istream& input);
+// Настройки make_base: serialization_settings, render_settings, routing_settings
+void ParseBaseSettings(svg::output::MapRenderer& render, RequestHandler& handler, const json::Dict& root);
+// make_base: текст разбирается потоково, узлы для base_requests не создаются
+void FillData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, const json::Buffer& buffer);
+// Применяет к существующей базе изменения: base_requests добавляют или заменяют остановки, расстояния
+// и маршруты, remove_requests удаляют маршруты, расстояния и остановки
+BaseChanges FillUpdateData(TransportCatalogue& transport_catalog, RequestHandler& handler, const json::Document& doc);
+void ParseStatRequest(RequestHandler& handler, const json::Node& item);
+void FillRequestsData(TransportCatalogue& transport_catalog, svg::output::MapRenderer& render, RequestHandler& handler, const json::Document& doc);
+// Режим process_requests_stream: первая строка input - serialization_settings, как в process_request.json,
+// каждая следующая - один запрос из stat_requests. Ответ выводится одной строкой сразу после чтения запроса,
+// поэтому память не зависит от длины потока.
+void ProcessRequestsStream(RequestHandler& handler, std::istream& input, std::ostream& output);
 
 }// namespace input
 }// namespace location
@@ -0,0 +1,102 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+namespace json {
+
+Writer& Writer::StartDict() {
+	BeforeValue();
+	handler_.StartDict();
+	states_.push_back(State::DICT_KEY);
+	return *this;
+}
+
+Writer& Writer::EndDict() {
+	if (states_.empty() || states_.back() != State::DICT_KEY) {
+		throw std::logic_error("EndDict outside of a dict or after a key");
+	}
+	states_.pop_back();
+	handler_.EndDict();
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::StartArray() {
+	BeforeValue();
+	handler_.StartArray();
+	states_.push_back(State::ARRAY);
+	return *this;
+}
+
+Writer& Writer::EndArray() {
+	if (states_.empty() || states_.back() != State::ARRAY) {
+		throw std::logic_error("EndArray outside of an array");
+	}
+	states_.pop_back();
+	handler_.EndArray();
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+	if (states_.empty() || states_.back() != State::DICT_KEY) {
+		throw std::logic_error("Key outside of a dict or after a key");
+	}
+	states_.back() = State::DICT_VALUE;
+	handler_.Key(key, false);
+	return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+	BeforeValue();
+	handler_.Value(Node());
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::Value(bool value) {
+	BeforeValue();
+	handler_.Value(Node(value));
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::Value(int value) {
+	BeforeValue();
+	handler_.Value(Node(value));
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::Value(double value) {
+	BeforeValue();
+	handler_.Value(Node(value));
+	AfterValue();
+	return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+	BeforeValue();
+	handler_.String(value, false);
+	AfterValue();
+	return *this;
+}
+
+void Writer::BeforeValue() {
+	if (complete_) {
+		throw std::logic_error("Value after the complete root");
+	}
+	if (!states_.empty() && states_.back() == State::DICT_KEY) {
+		throw std::logic_error("Value in a dict without a key");
+	}
+}
+
+void Writer::AfterValue() {
+	if (states_.empty()) {
+		complete_ = true;
+	} else if (states_.back() == State::DICT_VALUE) {
+		states_.back() = State::DICT_KEY;
+	}
+}
+
+}// namespace json
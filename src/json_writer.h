@@ -0,0 +1,53 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Потоковая замена Builder: проверяет порядок вызовов и сразу передаёт события обработчику -
+// Printer выводит ответ по мере формирования, NodeBuilder собирает из него узел.
+// Память - только стек вложенности.
+class Writer {
+public:
+	explicit Writer(Handler& handler)
+		: handler_(handler) {
+	}
+
+	Writer& StartDict();
+	Writer& EndDict();
+	Writer& StartArray();
+	Writer& EndArray();
+	Writer& Key(std::string_view key);
+
+	Writer& Value(std::nullptr_t);
+	Writer& Value(bool value);
+	Writer& Value(int value);
+	Writer& Value(double value);
+	Writer& Value(std::string_view value);
+	Writer& Value(const char* value) {
+		return Value(std::string_view(value));
+	}
+
+	// true, когда записано значение верхнего уровня
+	bool IsComplete() const {
+		return complete_;
+	}
+
+private:
+	enum class State : uint8_t {
+		ARRAY, DICT_KEY, DICT_VALUE,
+	};
+
+	Handler& handler_;
+	std::vector<State> states_;
+	bool complete_ = false;
+
+	void BeforeValue();
+	void AfterValue();
+};
+
+}// namespace json
@@ -13,11 +13,11 @@
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-	stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+	stream << "Usage: transport_catalogue [make_base [shard]|update_base|process_requests|process_requests_stream [file]]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
-	 if (argc != 2) {
+	 if (argc != 2 && !(argc == 3 && (argv[1] == "make_base"sv || argv[1] == "process_requests_stream"sv))) {
 		PrintUsage();
 		return 1;
 	}
@@ -27,17 +27,32 @@ int main(int argc, char* argv[]) {
 	graph::TransportRouter transport_router;
 	location::input::RequestHandler request_hander(transport_catalog, map_renderer, transport_router);
 	if (mode == "make_base"sv) {
-		std::fstream fin("make_base.json", std::ios::in);
-		location::input::FillData(transport_catalog, map_renderer, request_hander, fin);
+		location::input::FillData(transport_catalog, map_renderer, request_hander, *json::Buffer::MapFile("make_base.json"));
+		if (argc == 3) {
+			request_hander.SetShardToBuild(std::stoul(argv[2]));
+		}
 		request_hander.Save();
-
-		fin.close();
+	 } else if (mode == "update_base"sv) {
+		location::input::BaseChanges changes = location::input::FillUpdateData(transport_catalog, request_hander, json::LoadFile("update_base.json"));
+		request_hander.SaveUpdate(changes);
 	 } else if (mode == "process_requests"sv) {
-		std::fstream PR_fin("process_request.json", std::ios::in);
-		location::input::FillRequestsData(transport_catalog, map_renderer, request_hander, PR_fin);
-		PR_fin.close();
+		location::input::FillRequestsData(transport_catalog, map_renderer, request_hander, json::LoadFile("process_request.json"));
 		request_hander.Load();
-		json::Print(json::Document(request_hander.Result()), std::cout);
+		// ответ выводится по мере обработки запросов через собственный буфер std::cout
+		std::ios::sync_with_stdio(false);
+		request_hander.PrintResult(std::cout);
+	 } else if (mode == "process_requests_stream"sv) {
+		// запросы читаются из файла или из стандартного ввода
+		std::ifstream file;
+		if (argc == 3) {
+			file.open(argv[2]);
+			if (!file) {
+				std::cerr << "Can't open "sv << argv[2] << '\n';
+				return 1;
+			}
+		}
+		std::ios::sync_with_stdio(false);
+		location::input::ProcessRequestsStream(request_hander, argc == 3 ? file : std::cin, std::cout);
 	 } else {
 		 PrintUsage();
 		 return 1;
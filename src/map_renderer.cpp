@@ -1,11 +1,93 @@
 #include "map_renderer.h"
 
+#include <iterator>
+#include <limits>
+
 namespace svg {
 namespace output {
 
+namespace {
+
+// Точка линии маршрута: некольцевой маршрут проходится до конечной и обратно
+const location::Stop* LineStop(const location::Bus& route, size_t pos) {
+	const size_t size = route.route_stops.size();
+	return pos < size ? route.route_stops[pos] : route.route_stops[2 * size - 2 - pos];
+}
+
+size_t LineSize(const location::Bus& route) {
+	return route.is_circular ? route.route_stops.size() : 2 * route.route_stops.size() - 1;
+}
+
+geo::Box PointBox(geo::Coordinates point) {
+	return {point.lat, point.lng, point.lat, point.lng};
+}
+
+// Часть отрезка from + t * (to - from), t из [t0, t1], внутри прямоугольника min-max; false, если её нет
+bool ClipSegment(Point from, Point to, Point min, Point max, double& t0, double& t1) {
+	t0 = 0.0;
+	t1 = 1.0;
+	const double start[] = {from.x, from.y};
+	const double delta[] = {to.x - from.x, to.y - from.y};
+	const double low[] = {min.x, min.y};
+	const double high[] = {max.x, max.y};
+	for (int axis = 0; axis < 2; ++axis) {
+		if (delta[axis] == 0) {
+			if (start[axis] < low[axis] || start[axis] > high[axis]) {
+				return false;
+			}
+			continue;
+		}
+		double enter = (low[axis] - start[axis]) / delta[axis];
+		double leave = (high[axis] - start[axis]) / delta[axis];
+		if (enter > leave) {
+			std::swap(enter, leave);
+		}
+		t0 = std::max(t0, enter);
+		t1 = std::min(t1, leave);
+		if (t0 > t1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Point Interpolate(Point from, Point to, double t) {
+	return {from.x + t * (to.x - from.x), from.y + t * (to.y - from.y)};
+}
+
+// Задевает ли прямоугольник extent вокруг точки position область [0, width] x [0, height]
+bool IsVisible(Point position, const MapLayout::Extent& extent, double width, double height) {
+	return position.x + extent.right >= 0 && position.x + extent.left <= width
+			&& position.y + extent.bottom >= 0 && position.y + extent.top <= height;
+}
+
+}// namespace
+
 svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
-	return {(coords.lng - min_lon_) * zoom_coeff_ + padding_,
-			(max_lat_ - coords.lat) * zoom_coeff_ + padding_};
+	return {(coords.lng - min_lon_) * zoom_coeff_ + offset_x_,
+			(max_lat_ - coords.lat) * zoom_coeff_ + offset_y_};
+}
+
+SphereProjector SphereProjector::Tile(int zoom, int x, int y, double width, double height) const {
+	const double scale = std::ldexp(1.0, zoom);
+	SphereProjector result = *this;
+	result.zoom_coeff_ = zoom_coeff_ * scale;
+	result.offset_x_ = offset_x_ * scale - x * width;
+	result.offset_y_ = offset_y_ * scale - y * height;
+	return result;
+}
+
+std::optional<geo::Box> SphereProjector::VisibleArea(double width, double height, double margin) const {
+	if (zoom_coeff_ == 0) {
+		// все точки проецируются в одну
+		if (offset_x_ < -margin || offset_x_ > width + margin || offset_y_ < -margin || offset_y_ > height + margin) {
+			return std::nullopt;
+		}
+		const double infinity = std::numeric_limits<double>::infinity();
+		return geo::Box{-infinity, -infinity, infinity, infinity};
+	}
+	return geo::Box{max_lat_ - (height + margin - offset_y_) / zoom_coeff_, min_lon_ + (-margin - offset_x_) / zoom_coeff_,
+			max_lat_ - (-margin - offset_y_) / zoom_coeff_, min_lon_ + (width + margin - offset_x_) / zoom_coeff_};
 }
 
 bool IsZero(double value) {
@@ -40,149 +122,298 @@ void MapRenderer::InplacedSettings(RenderSettings& settings) {
 		settings_ = settings;
 	}
 
-void MapRenderer::AddText(svg::Document& doc, svg::Point position, svg::Color color, std::string data) const {
-	Text bus_name;
-	Text bus_name_underlayer;
-	bus_name.SetPosition(position);
-	bus_name.SetFillColor(color);
-	bus_name.SetOffset({std::get<0>(settings_.bus_label_offset), std::get<1>(settings_.bus_label_offset)});
-	bus_name.SetFontSize(settings_.bus_label_font_size);
-	bus_name.SetFontFamily("Verdana");
-	bus_name.SetFontWeight("bold");
-	bus_name.SetData(data);
-	//--
-	bus_name_underlayer = bus_name;
-	bus_name_underlayer.SetFillColor(settings_.underlayer_color);
-	bus_name_underlayer.SetStrokeColor(settings_.underlayer_color);
-	bus_name_underlayer.SetStrokeWidth(settings_.underlayer_width);
-	bus_name_underlayer.SetStrokeLineCap(StrokeLineCap::ROUND);
-	bus_name_underlayer.SetStrokeLineJoin(StrokeLineJoin::ROUND);
-	doc.Add(bus_name_underlayer);
-	doc.Add(bus_name);
-}
-
-void MapRenderer::AddLines(SphereProjector& converter, svg::Document& result_doc, const location::Bus& route,  size_t colour_selection) const {
-	Polyline route_line;
+void MapRenderer::AddText(Document& doc, const MapStyles& styles, Point position, uint32_t style, std::string_view data) const {
+	const svg::Point offset{settings_.bus_label_offset.first, settings_.bus_label_offset.second};
+	doc.AddText(position, offset, styles.bus_font, data, styles.underlayer);
+	doc.AddText(position, offset, styles.bus_font, data, style);
+}
+
+void MapRenderer::AddLines(SphereProjector& converter, Document& result_doc, const location::Bus& route, uint32_t style) const {
+	result_doc.StartPolyline(style);
 	for (const location::Stop* item :  route.route_stops) {
-		route_line.AddPoint(converter(item->coordinates));
+		result_doc.AddPoint(converter(item->coordinates));
 	}
 	if (!route.is_circular) {
 		for (auto iter = (route.route_stops.end() - 2); iter > route.route_stops.begin() - 1; --iter) {
 			const location::Stop* item = *iter;
-			route_line.AddPoint(converter(item->coordinates));
-		}
-	}
-	route_line.SetFillColor("none");
-	route_line.SetStrokeColor(settings_.color_palette[colour_selection]);
-	route_line.SetStrokeWidth(settings_.line_width);
-	route_line.SetStrokeLineCap(StrokeLineCap::ROUND);
-	route_line.SetStrokeLineJoin(StrokeLineJoin::ROUND);
-	result_doc.Add(route_line);
-}
-
-void MapRenderer::AddStopMarkers(SphereProjector& converter, svg::Document& result_doc, std::vector<const location::Stop*>& stop_list) const { //  uniq_stops_vect;
-		for (const location::Stop* item :  stop_list) {
-			Circle stop_marker;
-			stop_marker.SetCenter(converter(item->coordinates));
-			stop_marker.SetRadius(settings_.stop_radius);
-			stop_marker.SetFillColor("white");
-			result_doc.Add(stop_marker);
-		}
-}
-
-void MapRenderer::AddStopName(svg::Document& doc, svg::Point position, std::string name) const {
-	Text stop_name;
-	Text stop_name_underlayer;
-	stop_name.SetPosition(position);
-	stop_name.SetFillColor("black");
-	stop_name.SetOffset({std::get<0>(settings_.stop_label_offset), std::get<1>(settings_.stop_label_offset)});
-	stop_name.SetFontSize(settings_.stop_label_font_size);
-	stop_name.SetFontFamily("Verdana");
-	stop_name.SetData(name);
-	//--
-	stop_name_underlayer = stop_name;
-	stop_name_underlayer.SetFillColor(settings_.underlayer_color);
-	stop_name_underlayer.SetStrokeColor(settings_.underlayer_color);
-	stop_name_underlayer.SetStrokeWidth(settings_.underlayer_width);
-	stop_name_underlayer.SetStrokeLineCap(StrokeLineCap::ROUND);
-	stop_name_underlayer.SetStrokeLineJoin(StrokeLineJoin::ROUND);
-	doc.Add(stop_name_underlayer);
-	doc.Add(stop_name);
-}
-
-void MapRenderer::CreateMap(Document& result_doc, std::deque<location::Bus>& buses,  SphereProjector& converter,  std::vector<const location::Stop*>& uniq_stops_vect) const {
-	size_t colour_selection = 0;
-	std::vector<size_t> color_reminder;
-	for (const location::Bus& route : buses) {  //make route lines
-		if (route.route_stops.size() != 0) {
-		if (colour_selection == settings_.color_palette.size()) {
-			colour_selection = 0;
+			result_doc.AddPoint(converter(item->coordinates));
 		}
-		color_reminder.push_back(colour_selection);
-		AddLines(converter, result_doc, route, colour_selection);
-		++colour_selection;
+	}
+}
+
+void MapRenderer::AddStopMarkers(SphereProjector& converter, Document& result_doc, const MapStyles& styles, const std::vector<const location::Stop*>& stop_list) const {
+	for (const location::Stop* item :  stop_list) {
+		result_doc.AddCircle(converter(item->coordinates), settings_.stop_radius, styles.stop_marker);
+	}
+}
+
+void MapRenderer::AddStopName(Document& doc, const MapStyles& styles, Point position, std::string_view name) const {
+	const svg::Point offset{settings_.stop_label_offset.first, settings_.stop_label_offset.second};
+	doc.AddText(position, offset, styles.stop_font, name, styles.underlayer);
+	doc.AddText(position, offset, styles.stop_font, name, styles.stop_label);
+}
+
+void MapRenderer::CreateMap(Document& result_doc, const std::vector<const location::Bus*>& buses, SphereProjector& converter, const std::vector<const location::Stop*>& uniq_stops_vect) const {
+	const MapStyles styles = AddStyles(result_doc);
+	size_t colour_selection = 0;
+	for (const location::Bus* route : buses) {  //make route lines
+		if (route->route_stops.size() != 0) {
+			if (colour_selection == settings_.color_palette.size()) {
+				colour_selection = 0;
+			}
+			AddLines(converter, result_doc, *route, styles.lines[colour_selection]);
+			++colour_selection;
 		}
 	}
 	colour_selection = 0;
-	for (const location::Bus& route : buses) { //make bus names
-		if (route.route_stops.size() != 0) {
-			if (route.is_circular) {
-				AddText(result_doc, converter((*route.route_stops.begin())->coordinates), settings_.color_palette[color_reminder[colour_selection]], route.route_number);
-			} else {
-				if ((*(route.route_stops.begin()))->name != (*(route.route_stops.end() - 1))->name) {
-					AddText(result_doc, converter((*route.route_stops.begin())->coordinates), settings_.color_palette[color_reminder[colour_selection]], route.route_number);
-					AddText(result_doc, converter((*(route.route_stops.end() - 1))->coordinates), settings_.color_palette[color_reminder[colour_selection]], route.route_number);
-				} else {
-					AddText(result_doc, converter((*route.route_stops.begin())->coordinates), settings_.color_palette[color_reminder[colour_selection]], route.route_number);
-				}
+	for (const location::Bus* route : buses) { //make bus names
+		if (route->route_stops.size() != 0) {
+			if (colour_selection == settings_.color_palette.size()) {
+				colour_selection = 0;
+			}
+			const uint32_t style = styles.bus_labels[colour_selection];
+			const location::Stop* first = route->route_stops.front();
+			const location::Stop* last = route->route_stops.back();
+			AddText(result_doc, styles, converter(first->coordinates), style, route->route_number);
+			if (!route->is_circular && first->name != last->name) {
+				AddText(result_doc, styles, converter(last->coordinates), style, route->route_number);
 			}
 			++colour_selection;
 		}
 	}
-	if (!uniq_stops_vect.empty()) { //make stop markers
-		AddStopMarkers(converter, result_doc, uniq_stops_vect);
+	//make stop markers
+	AddStopMarkers(converter, result_doc, styles, uniq_stops_vect);
+	//make stop names
+	for (const location::Stop* item : uniq_stops_vect) {
+		AddStopName(result_doc, styles, converter(item->coordinates), item->name);
+	}
+}
+
+std::string MapRenderer::RenderMap(const location::TransportCatalogue& transport_catalog) const {
+	std::vector<const location::Bus*> buses;
+	std::vector<const location::Stop*> uniq_stops_vect;
+	CollectMapObjects(transport_catalog, buses, uniq_stops_vect);
+	SphereProjector converter = MakeProjector(uniq_stops_vect);
+	//--------------------------------------------- make parts
+	Document result_map;
+	CreateMap(result_map, buses, converter, uniq_stops_vect);
+	//--------------------------------------------- output(
+	std::string result;
+	result_map.Render(result);
+	return result;
+}
+
+MapLayout MapRenderer::BuildLayout(const location::TransportCatalogue& transport_catalog) const {
+	MapLayout layout;
+	std::vector<const location::Bus*> buses;
+	CollectMapObjects(transport_catalog, buses, layout.stops);
+	layout.projector = MakeProjector(layout.stops);
+	layout.margin = std::max(settings_.line_width, settings_.stop_radius);
+	std::vector<geo::Box> boxes;
+	for (const location::Bus* route : buses) {
+		if (route->route_stops.empty()) {
+			continue;
+		}
+		const uint32_t line = static_cast<uint32_t>(layout.lines.size());
+		layout.lines.push_back(route);
+		// линия из одной точки - отрезок нулевой длины
+		const size_t segments = std::max<size_t>(LineSize(*route), 2) - 1;
+		for (size_t pos = 0; pos < segments; ++pos) {
+			const geo::Coordinates from = LineStop(*route, pos)->coordinates;
+			const geo::Coordinates to = LineStop(*route, std::min(pos + 1, LineSize(*route) - 1))->coordinates;
+			layout.segments.push_back({line, static_cast<uint32_t>(pos)});
+			boxes.push_back({std::min(from.lat, to.lat), std::min(from.lng, to.lng), std::max(from.lat, to.lat), std::max(from.lng, to.lng)});
+		}
+	}
+	for (uint32_t line = 0; line < layout.lines.size(); ++line) {
+		const location::Bus* route = layout.lines[line];
+		const location::Stop* first = route->route_stops.front();
+		const location::Stop* last = route->route_stops.back();
+		layout.labels.push_back({line, first});
+		if (!route->is_circular && first->name != last->name) {
+			layout.labels.push_back({line, last});
+		}
+	}
+	for (const MapLayout::Label& label : layout.labels) {
+		layout.label_extents.push_back(LabelExtent(layout.lines[label.line]->route_number, settings_.bus_label_offset, settings_.bus_label_font_size));
+		boxes.push_back(PointBox(label.stop->coordinates));
+	}
+	for (const location::Stop* stop : layout.stops) {
+		layout.stop_extents.push_back(LabelExtent(stop->name, settings_.stop_label_offset, settings_.stop_label_font_size));
+		boxes.push_back(PointBox(stop->coordinates));
 	}
-	if (!uniq_stops_vect.empty()) { //make stop names
-		for (const location::Stop* item : uniq_stops_vect) {
-			AddStopName(result_doc, converter(item->coordinates), item->name);
+	for (const auto* extents : {&layout.label_extents, &layout.stop_extents}) {
+		for (const MapLayout::Extent& extent : *extents) {
+			layout.margin = std::max({layout.margin, -extent.left, -extent.top, extent.right, extent.bottom});
 		}
 	}
+	layout.index.Build(boxes);
+	return layout;
 }
 
-json::Node MapRenderer::RenderMap(location::TransportCatalogue& transport_catalog) const {
-	//--------------------------------------------- make sort buses names
-	auto buses = transport_catalog.GetRoutes();
-	std::sort(buses.begin(), buses.end(), [](const location::Bus& route_a, const location::Bus& route_b) {
-		return std::lexicographical_compare(route_a.route_number.begin(), route_a.route_number.end(), route_b.route_number.begin(), route_b.route_number.end()) ;
-		});
-	//--------------------------------------------- make uniq stops list of all routes, and sort it
-	std::set<const location::Stop*>  uniq_stops;
-	for (const location::Bus& route : buses) {
-		for (auto item : route.route_stops) {
-			uniq_stops.insert(item);
+std::string MapRenderer::RenderTile(const MapLayout& layout, const location::TileArea& area) const {
+	SphereProjector projector;
+	if (area.bounds) {
+		const geo::Coordinates corners[] = {area.bounds->first, area.bounds->second};
+		projector = SphereProjector(std::begin(corners), std::end(corners), settings_.width, settings_.height, 0.0);
+	} else {
+		projector = layout.projector.Tile(area.zoom, area.x, area.y, settings_.width, settings_.height);
+	}
+	Document result_tile;
+	const MapStyles styles = AddStyles(result_tile);
+	if (const std::optional<geo::Box> visible = projector.VisibleArea(settings_.width, settings_.height, layout.margin)) {
+		// найденные id идут в порядке отрисовки
+		const std::vector<uint32_t> found = layout.index.Find(*visible);
+		const uint32_t labels_id = static_cast<uint32_t>(layout.segments.size());
+		const uint32_t stops_id = labels_id + static_cast<uint32_t>(layout.labels.size());
+		const uint32_t* labels_begin = std::lower_bound(found.data(), found.data() + found.size(), labels_id);
+		const uint32_t* stops_begin = std::lower_bound(labels_begin, found.data() + found.size(), stops_id);
+		const uint32_t* stops_end = found.data() + found.size();
+		AddTileLines(result_tile, styles, layout, projector, found.data(), labels_begin);
+		for (const uint32_t* id = labels_begin; id != stops_begin; ++id) {
+			const MapLayout::Label& label = layout.labels[*id - labels_id];
+			const Point position = projector(label.stop->coordinates);
+			if (IsVisible(position, layout.label_extents[*id - labels_id], settings_.width, settings_.height)) {
+				const uint32_t style = styles.bus_labels[label.line % settings_.color_palette.size()];
+				AddText(result_tile, styles, position, style, layout.lines[label.line]->route_number);
+			}
+		}
+		const double radius = settings_.stop_radius;
+		for (const uint32_t* id = stops_begin; id != stops_end; ++id) {
+			const Point position = projector(layout.stops[*id - stops_id]->coordinates);
+			if (IsVisible(position, {-radius, -radius, radius, radius}, settings_.width, settings_.height)) {
+				result_tile.AddCircle(position, radius, styles.stop_marker);
+			}
+		}
+		for (const uint32_t* id = stops_begin; id != stops_end; ++id) {
+			const location::Stop* stop = layout.stops[*id - stops_id];
+			const Point position = projector(stop->coordinates);
+			if (IsVisible(position, layout.stop_extents[*id - stops_id], settings_.width, settings_.height)) {
+				AddStopName(result_tile, styles, position, stop->name);
+			}
 		}
 	}
-	std::vector<const location::Stop*> uniq_stops_vect;
-	for (auto item : uniq_stops) {
-		uniq_stops_vect.push_back(item);
+	std::string result;
+	result_tile.Render(result);
+	return result;
+}
+
+//   -----------------------private-----------------------
+
+void MapRenderer::CollectMapObjects(const location::TransportCatalogue& transport_catalog, std::vector<const location::Bus*>& buses,
+		std::vector<const location::Stop*>& uniq_stops_vect) const {
+	//--------------------------------------------- make sort buses names
+	const auto& routes = transport_catalog.GetRoutes();
+	buses.reserve(routes.size());
+	size_t stops_count = 0;
+	for (const location::Bus& route : routes) {
+		buses.push_back(&route);
+		stops_count += route.route_stops.size();
+	}
+	std::sort(buses.begin(), buses.end(), [](const location::Bus* route_a, const location::Bus* route_b) {
+		return std::lexicographical_compare(route_a->route_number.begin(), route_a->route_number.end(), route_b->route_number.begin(), route_b->route_number.end());
+	});
+	//--------------------------------------------- make uniq stops list of all routes, and sort it
+	uniq_stops_vect.reserve(stops_count);
+	for (const location::Bus* route : buses) {
+		uniq_stops_vect.insert(uniq_stops_vect.end(), route->route_stops.begin(), route->route_stops.end());
 	}
+	// повторы убираются до сортировки по имени, где сравнение дороже
+	std::sort(uniq_stops_vect.begin(), uniq_stops_vect.end());
+	uniq_stops_vect.erase(std::unique(uniq_stops_vect.begin(), uniq_stops_vect.end()), uniq_stops_vect.end());
 	std::sort(uniq_stops_vect.begin(), uniq_stops_vect.end(), [](const location::Stop* stop_a, const location::Stop* stop_b) {
-			return std::lexicographical_compare(stop_a->name.begin(), stop_a->name.end(), stop_b->name.begin(), stop_b->name.end()) ;
-			});
-	//--------------------------------------------- converter from Coordinates to Point
+		return std::lexicographical_compare(stop_a->name.begin(), stop_a->name.end(), stop_b->name.begin(), stop_b->name.end());
+	});
+}
+
+SphereProjector MapRenderer::MakeProjector(const std::vector<const location::Stop*>& uniq_stops_vect) const {
 	std::vector<geo::Coordinates> collect_coordinates;
-	collect_coordinates.reserve(transport_catalog.GetStops().size() + 1);
+	collect_coordinates.reserve(uniq_stops_vect.size());
 	for (const  location::Stop* stop : uniq_stops_vect) {
 		collect_coordinates.push_back(stop->coordinates);
 	}
-	SphereProjector converter(collect_coordinates.begin(), collect_coordinates.end(), settings_.width, settings_.height, settings_.padding);
-	//--------------------------------------------- make parts
-	Document result_map;
-	CreateMap(result_map, buses, converter, uniq_stops_vect);
-	//--------------------------------------------- output(
-	std::ostringstream out;
-	result_map.Render(out);
-	return {out.str()};
+	return SphereProjector(collect_coordinates.begin(), collect_coordinates.end(), settings_.width, settings_.height, settings_.padding);
+}
+
+MapLayout::Extent MapRenderer::LabelExtent(std::string_view data, std::pair<double, double> offset, int font_size) const {
+	// символ не шире размера шрифта; в UTF-8 считаются первые байты символов
+	const auto chars = std::count_if(data.begin(), data.end(), [](char c) {
+		return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+	});
+	const double pad = settings_.underlayer_width;
+	return {offset.first - pad, offset.second - font_size - pad,
+			offset.first + static_cast<double>(chars) * font_size + pad, offset.second + font_size + pad};
+}
+
+void MapRenderer::AddTileLines(Document& doc, const MapStyles& styles, const MapLayout& layout, const SphereProjector& projector,
+		const uint32_t* begin, const uint32_t* end) const {
+	// за краем плитки остаётся запас на толщину линии
+	const double pad = settings_.line_width;
+	const Point min{-pad, -pad};
+	const Point max{settings_.width + pad, settings_.height + pad};
+	// линия продолжается, пока отрезки идут подряд и не выходят за край
+	bool open = false;
+	const MapLayout::Segment* previous = nullptr;
+	for (const uint32_t* id = begin; id != end; ++id) {
+		const MapLayout::Segment& segment = layout.segments[*id];
+		const location::Bus& route = *layout.lines[segment.line];
+		const size_t size = LineSize(route);
+		const Point from = projector(LineStop(route, segment.from)->coordinates);
+		const Point to = projector(LineStop(route, std::min<size_t>(segment.from + 1, size - 1))->coordinates);
+		double t0 = 0.0;
+		double t1 = 1.0;
+		if (!ClipSegment(from, to, min, max, t0, t1)) {
+			open = false;
+			continue;
+		}
+		const bool continued = open && previous->line == segment.line && previous->from + 1 == segment.from && t0 == 0.0;
+		if (!continued) {
+			doc.StartPolyline(styles.lines[segment.line % settings_.color_palette.size()]);
+			doc.AddPoint(t0 > 0.0 ? Interpolate(from, to, t0) : from);
+		}
+		if (size > 1) {
+			doc.AddPoint(t1 < 1.0 ? Interpolate(from, to, t1) : to);
+		}
+		open = t1 == 1.0;
+		previous = &segment;
+	}
+}
+
+MapRenderer::MapStyles MapRenderer::AddStyles(Document& doc) const {
+	using namespace std::literals;
+	MapStyles styles;
+	Style underlayer;
+	underlayer.fill_color = settings_.underlayer_color;
+	underlayer.stroke_color = settings_.underlayer_color;
+	underlayer.stroke_width = settings_.underlayer_width;
+	underlayer.line_cap = StrokeLineCap::ROUND;
+	underlayer.line_join = StrokeLineJoin::ROUND;
+
+	for (const svg::Color& color : settings_.color_palette) {
+		Style line;
+		line.fill_color = NoneColor;
+		line.stroke_color = color;
+		line.stroke_width = settings_.line_width;
+		line.line_cap = StrokeLineCap::ROUND;
+		line.line_join = StrokeLineJoin::ROUND;
+		styles.lines.push_back(doc.AddStyle(line));
+	}
+	for (const svg::Color& color : settings_.color_palette) {
+		Style label;
+		label.fill_color = color;
+		styles.bus_labels.push_back(doc.AddStyle(label));
+	}
+	styles.underlayer = doc.AddStyle(underlayer);
+	Style marker;
+	marker.fill_color = "white"s;
+	styles.stop_marker = doc.AddStyle(marker);
+	Style stop_label;
+	stop_label.fill_color = "black"s;
+	styles.stop_label = doc.AddStyle(stop_label);
+
+	styles.bus_font = doc.AddFont(static_cast<uint32_t>(settings_.bus_label_font_size), "Verdana"sv, "bold"sv);
+	styles.stop_font = doc.AddFont(static_cast<uint32_t>(settings_.stop_label_font_size), "Verdana"sv, ""sv);
+	return styles;
 }
 
 }// namespace output
@@ -5,8 +5,8 @@
 #include "transport_catalogue.h"
 
 #include <algorithm>
-#include <set>
-#include <sstream>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 namespace svg {
@@ -17,14 +17,23 @@ bool IsZero(double value);
 
 class SphereProjector {
 public:
+	SphereProjector() = default;
 	template <typename PointInputIt>
 	SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
 					double max_height, double padding);
 
 	svg::Point operator()(geo::Coordinates coords) const;
 
+	// Проекция плитки x, y карты размером width x height, разбитой на 2^zoom x 2^zoom плиток,
+	// в размер всей карты
+	SphereProjector Tile(int zoom, int x, int y, double width, double height) const;
+	// Координаты, которые проецируются в [-margin, width + margin] x [-margin, height + margin];
+	// nullopt, если туда не попадает ни одна точка
+	std::optional<geo::Box> VisibleArea(double width, double height, double margin) const;
+
 private:
-	double padding_;
+	double offset_x_ = 0;
+	double offset_y_ = 0;
 	double min_lon_ = 0;
 	double max_lat_ = 0;
 	double zoom_coeff_ = 0;
@@ -49,6 +58,40 @@ struct RenderSettings {
 
 svg::Color MakeColor(RawColor& raw_color);
 
+// Карта, подготовленная для плиток: элементы полной карты в порядке отрисовки и индекс их положения.
+// id в индексе: сначала отрезки линий, затем названия маршрутов, затем остановки.
+struct MapLayout {
+	// Отрезок линии маршрута между точками from и from + 1 (обратный путь некольцевого маршрута
+	// продолжает нумерацию)
+	struct Segment {
+		uint32_t line;
+		uint32_t from;
+	};
+	struct Label {
+		uint32_t line;
+		const location::Stop* stop;
+	};
+	// Оценка прямоугольника надписи относительно её точки в пикселях
+	struct Extent {
+		double left;
+		double top;
+		double right;
+		double bottom;
+	};
+
+	// непустые маршруты; цвет линии - номер по модулю размера палитры
+	std::vector<const location::Bus*> lines;
+	std::vector<const location::Stop*> stops;
+	std::vector<Segment> segments;
+	std::vector<Label> labels;
+	std::vector<Extent> label_extents;
+	std::vector<Extent> stop_extents;
+	SphereProjector projector;
+	// насколько элементы выступают за свою точку, в пикселях
+	double margin = 0;
+	geo::BoxIndex index;
+};
+
 
 class MapRenderer {
 public:
@@ -60,18 +103,43 @@ public:
 		return &settings_;
 	}
 
-	void AddText(svg::Document& doc, svg::Point position, svg::Color color, std::string data) const;
-	void AddLines(SphereProjector& converter, svg::Document& result_doc, const location::Bus& route,  size_t colour_selection) const;
-	void AddStopMarkers(SphereProjector& converter, svg::Document& result_doc, std::vector<const location::Stop*>& stop_list) const;
-	void AddStopName(svg::Document& doc, svg::Point position, std::string name) const;
+	std::string RenderMap(const location::TransportCatalogue& transport_catalog) const;
 
-	void CreateMap(Document& result_doc, std::deque<location::Bus>& buses,  SphereProjector& converter,  std::vector<const location::Stop*>& uniq_stops_vect) const;
-
-	json::Node RenderMap(location::TransportCatalogue& transport_catalog) const;
+	MapLayout BuildLayout(const location::TransportCatalogue& transport_catalog) const;
+	// Часть карты: только элементы, которые видны в области, линии обрезаются по её краям
+	std::string RenderTile(const MapLayout& layout, const location::TileArea& area) const;
 
 private:
+	// Номера оформлений и шрифтов элементов карты в документе
+	struct MapStyles {
+		std::vector<uint32_t> lines; // по цветам палитры
+		std::vector<uint32_t> bus_labels;
+		uint32_t underlayer = 0;
+		uint32_t stop_marker = 0;
+		uint32_t stop_label = 0;
+		uint32_t bus_font = 0;
+		uint32_t stop_font = 0;
+	};
+
 	RenderSettings settings_;
 
+	MapStyles AddStyles(Document& doc) const;
+	void AddText(Document& doc, const MapStyles& styles, Point position, uint32_t style, std::string_view data) const;
+	void AddLines(SphereProjector& converter, Document& result_doc, const location::Bus& route, uint32_t style) const;
+	void AddStopMarkers(SphereProjector& converter, Document& result_doc, const MapStyles& styles, const std::vector<const location::Stop*>& stop_list) const;
+	void AddStopName(Document& doc, const MapStyles& styles, Point position, std::string_view name) const;
+
+	void CreateMap(Document& result_doc, const std::vector<const location::Bus*>& buses, SphereProjector& converter, const std::vector<const location::Stop*>& uniq_stops_vect) const;
+
+	// Маршруты и их остановки в порядке отрисовки: по названиям
+	void CollectMapObjects(const location::TransportCatalogue& transport_catalog, std::vector<const location::Bus*>& buses,
+			std::vector<const location::Stop*>& uniq_stops_vect) const;
+	SphereProjector MakeProjector(const std::vector<const location::Stop*>& uniq_stops_vect) const;
+	MapLayout::Extent LabelExtent(std::string_view data, std::pair<double, double> offset, int font_size) const;
+
+	void AddTileLines(Document& doc, const MapStyles& styles, const MapLayout& layout, const SphereProjector& projector,
+			const uint32_t* begin, const uint32_t* end) const;
+
 };
 
 //--------------------------------- SphereProjector templateted method ---------------------------------
@@ -79,7 +147,8 @@ private:
 template <typename PointInputIt>
 SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
 					double max_height, double padding)
-		: padding_(padding) {
+		: offset_x_(padding)
+		, offset_y_(padding) {
 	if (points_begin == points_end) {
 		return;
 	}
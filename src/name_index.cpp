@@ -0,0 +1,251 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace location {
+
+namespace {
+
+// Некорректные последовательности разбираются побайтно: важно лишь, что названия и запросы
+// раскладываются на символы одинаково
+void DecodeUtf8(std::string_view text, std::vector<uint32_t>& result) {
+	for (size_t i = 0; i < text.size();) {
+		const unsigned char lead = static_cast<unsigned char>(text[i]);
+		size_t length = 1;
+		if (lead >> 5 == 0x6) {
+			length = 2;
+		} else if (lead >> 4 == 0xE) {
+			length = 3;
+		} else if (lead >> 3 == 0x1E) {
+			length = 4;
+		}
+		if (i + length > text.size()) {
+			length = 1;
+		}
+		uint32_t code = length == 1 ? lead : lead & (0x7F >> length);
+		for (size_t j = 1; j < length; ++j) {
+			code = (code << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+		}
+		result.push_back(code);
+		i += length;
+	}
+}
+
+std::vector<uint32_t> DecodeUtf8(std::string_view text) {
+	std::vector<uint32_t> result;
+	result.reserve(text.size());
+	DecodeUtf8(text, result);
+	return result;
+}
+
+}// namespace
+
+void NameIndex::Build(const std::vector<std::string_view>& names) {
+	// символы всех названий лежат в одном буфере, название id - участок [offsets[id], offsets[id + 1])
+	std::vector<uint32_t> symbols;
+	std::vector<uint32_t> offsets(names.size() + 1, 0);
+	size_t total_size = 0;
+	for (std::string_view name : names) {
+		total_size += name.size();
+	}
+	symbols.reserve(total_size);
+	for (size_t id = 0; id < names.size(); ++id) {
+		DecodeUtf8(names[id], symbols);
+		offsets[id + 1] = static_cast<uint32_t>(symbols.size());
+	}
+	auto name_begin = [&symbols, &offsets](uint32_t id) {
+		return symbols.begin() + offsets[id];
+	};
+	auto name_end = [&symbols, &offsets](uint32_t id) {
+		return symbols.begin() + offsets[id + 1];
+	};
+	const uint32_t count = static_cast<uint32_t>(names.size());
+	ids_.resize(count);
+	std::iota(ids_.begin(), ids_.end(), 0);
+	auto symbols_less = [&name_begin, &name_end](uint32_t lhs, uint32_t rhs) {
+		return std::lexicographical_compare(name_begin(lhs), name_end(lhs), name_begin(rhs), name_end(rhs));
+	};
+	// для корректного UTF-8 порядок байтов совпадает с порядком символов, а сравнение байтов дешевле
+	std::sort(ids_.begin(), ids_.end(), [&names](uint32_t lhs, uint32_t rhs) {
+		return names[lhs] < names[rhs];
+	});
+	if (!std::is_sorted(ids_.begin(), ids_.end(), symbols_less)) {
+		std::sort(ids_.begin(), ids_.end(), symbols_less);
+	}
+
+	// Проход по отсортированным названиям строит дерево в порядке обхода в глубину:
+	// от пути предыдущего названия остаётся общий префикс, остаток достраивается новыми узлами
+	const uint32_t none = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> parents(1, none);
+	std::vector<uint32_t> labels(1, 0);
+	std::vector<uint32_t> first(1, 0);
+	std::vector<uint32_t> last(1, count);
+	std::vector<uint32_t> path(1, 0);
+	for (uint32_t position = 0; position < count; ++position) {
+		const auto begin = name_begin(ids_[position]);
+		const auto end = name_end(ids_[position]);
+		size_t common = 0;
+		if (position > 0) {
+			const auto previous_begin = name_begin(ids_[position - 1]);
+			const auto previous_end = name_end(ids_[position - 1]);
+			common = std::mismatch(begin, end, previous_begin, previous_end).first - begin;
+		}
+		for (; path.size() > common + 1; path.pop_back()) {
+			last[path.back()] = position;
+		}
+		for (auto symbol = begin + common; symbol != end; ++symbol) {
+			parents.push_back(path.back());
+			labels.push_back(*symbol);
+			first.push_back(position);
+			last.push_back(count);
+			path.push_back(static_cast<uint32_t>(parents.size() - 1));
+		}
+	}
+
+	// Перенумерация в ширину. Братья появились в порядке возрастания символов, раскладка детей
+	// по родителям подсчётом этот порядок сохраняет.
+	const size_t nodes = parents.size();
+	std::vector<uint32_t> children_offsets(nodes + 1, 0);
+	for (size_t node = 1; node < nodes; ++node) {
+		++children_offsets[parents[node] + 1];
+	}
+	for (size_t node = 0; node < nodes; ++node) {
+		children_offsets[node + 1] += children_offsets[node];
+	}
+	std::vector<uint32_t> children(nodes > 0 ? nodes - 1 : 0);
+	std::vector<uint32_t> fill_position(children_offsets.begin(), children_offsets.end() - 1);
+	for (size_t node = 1; node < nodes; ++node) {
+		children[fill_position[parents[node]]++] = static_cast<uint32_t>(node);
+	}
+	std::vector<uint32_t> order;
+	order.reserve(nodes);
+	order.push_back(0);
+	child_offsets_.clear();
+	child_offsets_.reserve(nodes + 1);
+	labels_.clear();
+	labels_.reserve(nodes - 1);
+	for (size_t i = 0; i < order.size(); ++i) {
+		const uint32_t node = order[i];
+		child_offsets_.push_back(static_cast<uint32_t>(order.size() - 1));
+		for (uint32_t child = children_offsets[node]; child < children_offsets[node + 1]; ++child) {
+			order.push_back(children[child]);
+			labels_.push_back(labels[children[child]]);
+		}
+	}
+	child_offsets_.push_back(static_cast<uint32_t>(labels_.size()));
+	first_.resize(nodes);
+	last_.resize(nodes);
+	for (size_t i = 0; i < nodes; ++i) {
+		first_[i] = first[order[i]];
+		last_[i] = last[order[i]];
+	}
+}
+
+bool NameIndex::Assign(std::vector<uint32_t> child_offsets, std::vector<uint32_t> labels,
+		std::vector<uint32_t> first, std::vector<uint32_t> last, std::vector<uint32_t> ids) {
+	const size_t nodes = first.size();
+	bool valid = nodes > 0 && last.size() == nodes && labels.size() == nodes - 1
+			&& child_offsets.size() == nodes + 1 && child_offsets.back() == labels.size()
+			&& std::is_sorted(child_offsets.begin(), child_offsets.end());
+	for (size_t node = 0; valid && node < nodes; ++node) {
+		valid = first[node] <= last[node] && last[node] <= ids.size();
+	}
+	for (size_t i = 0; valid && i < ids.size(); ++i) {
+		valid = ids[i] < ids.size();
+	}
+	if (!valid) {
+		*this = NameIndex{};
+		return false;
+	}
+	child_offsets_ = std::move(child_offsets);
+	labels_ = std::move(labels);
+	first_ = std::move(first);
+	last_ = std::move(last);
+	ids_ = std::move(ids);
+	return true;
+}
+
+std::vector<uint32_t> NameIndex::FindByPrefix(std::string_view prefix, size_t count, bool fuzzy) const {
+	std::vector<uint32_t> result;
+	if (count == 0 || first_.empty()) {
+		return result;
+	}
+	const std::vector<uint32_t> query = DecodeUtf8(prefix);
+	uint32_t node = 0;
+	bool exact = true;
+	for (uint32_t label : query) {
+		node = FindChild(node, label);
+		if (!node) {
+			exact = false;
+			break;
+		}
+	}
+	// точные совпадения, если они есть, - участок [exact_first, exact_last)
+	uint32_t exact_first = 0;
+	uint32_t exact_last = 0;
+	if (exact) {
+		exact_first = first_[node];
+		exact_last = last_[node];
+		for (uint32_t i = exact_first; i < exact_last && result.size() < count; ++i) {
+			result.push_back(ids_[i]);
+		}
+	}
+	if (!fuzzy || result.size() == count) {
+		return result;
+	}
+
+	std::vector<uint32_t> row(query.size() + 1);
+	std::iota(row.begin(), row.end(), 0);
+	std::vector<uint32_t> nodes;
+	CollectFuzzy(0, query, row, nodes);
+	// поддеревья найденных узлов не пересекаются
+	std::sort(nodes.begin(), nodes.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return first_[lhs] < first_[rhs];
+	});
+	for (uint32_t found : nodes) {
+		for (uint32_t i = first_[found]; i < last_[found]; ++i) {
+			if (i == exact_first && exact_first < exact_last) {
+				i = exact_last - 1;
+				continue;
+			}
+			result.push_back(ids_[i]);
+			if (result.size() == count) {
+				return result;
+			}
+		}
+	}
+	return result;
+}
+
+uint32_t NameIndex::FindChild(uint32_t node, uint32_t label) const {
+	const auto begin = labels_.begin() + child_offsets_[node];
+	const auto end = labels_.begin() + child_offsets_[node + 1];
+	const auto found = std::lower_bound(begin, end, label);
+	if (found == end || *found != label) {
+		return 0;
+	}
+	return static_cast<uint32_t>(found - labels_.begin()) + 1;
+}
+
+void NameIndex::CollectFuzzy(uint32_t node, const std::vector<uint32_t>& query, const std::vector<uint32_t>& row,
+		std::vector<uint32_t>& nodes) const {
+	if (row.back() <= 1) {
+		nodes.push_back(node);
+		return;
+	}
+	if (*std::min_element(row.begin(), row.end()) > 1) {
+		return;
+	}
+	std::vector<uint32_t> next(row.size());
+	for (uint32_t edge = child_offsets_[node]; edge < child_offsets_[node + 1]; ++edge) {
+		next[0] = row[0] + 1;
+		for (size_t i = 1; i < row.size(); ++i) {
+			next[i] = std::min({row[i] + 1, next[i - 1] + 1, row[i - 1] + (query[i - 1] != labels_[edge] ? 1u : 0u)});
+		}
+		CollectFuzzy(edge + 1, query, next, nodes);
+	}
+}
+
+}// namespace location
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace location {
+
+// Префиксное дерево по символам Unicode (названия в UTF-8). Узлы пронумерованы в ширину, поэтому
+// дети узла идут подряд и ребро i ведёт в узел i + 1 - отдельный массив детей не нужен. Каждому узлу
+// соответствует непрерывный участок ids_ - id названий с этим префиксом в лексикографическом порядке.
+// id названия - его позиция в векторе, переданном в Build.
+class NameIndex {
+public:
+	void Build(const std::vector<std::string_view>& names);
+	// Проверяет согласованность массивов; при ошибке возвращает false и оставляет индекс пустым
+	bool Assign(std::vector<uint32_t> child_offsets, std::vector<uint32_t> labels,
+			std::vector<uint32_t> first, std::vector<uint32_t> last, std::vector<uint32_t> ids);
+
+	// До count названий, начинающихся с prefix, по алфавиту. При fuzzy следом идут названия,
+	// префикс которых отличается от prefix на одну вставку, удаление или замену символа.
+	std::vector<uint32_t> FindByPrefix(std::string_view prefix, size_t count, bool fuzzy) const;
+
+	const std::vector<uint32_t>& GetChildOffsets() const { return child_offsets_; }
+	const std::vector<uint32_t>& GetLabels() const { return labels_; }
+	const std::vector<uint32_t>& GetFirst() const { return first_; }
+	const std::vector<uint32_t>& GetLast() const { return last_; }
+	const std::vector<uint32_t>& GetIds() const { return ids_; }
+
+private:
+	std::vector<uint32_t> child_offsets_;
+	std::vector<uint32_t> labels_;
+	std::vector<uint32_t> first_;
+	std::vector<uint32_t> last_;
+	std::vector<uint32_t> ids_;
+
+	// Узел-ребёнок node по символу label или 0, если такого нет
+	uint32_t FindChild(uint32_t node, uint32_t label) const;
+	// Обход в глубину; row[i] - расстояние Левенштейна между первыми i символами query и путём до node.
+	// Узлы, путь до которых отличается от query не больше чем на одну правку, добавляются в nodes,
+	// их поддеревья уже не обходятся.
+	void CollectFuzzy(uint32_t node, const std::vector<uint32_t>& query, const std::vector<uint32_t>& row,
+			std::vector<uint32_t>& nodes) const;
+};
+
+}// namespace location
@@ -0,0 +1,25 @@
+#include "number_format.h"
+
+#include <charconv>
+#include <cstdio>
+
+namespace format {
+
+char* WriteNumber(char* buffer, double value) {
+#if defined(__cpp_lib_to_chars)
+	return std::to_chars(buffer, buffer + NUMBER_SIZE, value, std::chars_format::general, 6).ptr;
+#else
+	// без to_chars для double
+	return buffer + std::snprintf(buffer, NUMBER_SIZE, "%g", value);
+#endif
+}
+
+char* WriteNumber(char* buffer, int value) {
+	return std::to_chars(buffer, buffer + NUMBER_SIZE, value).ptr;
+}
+
+char* WriteNumber(char* buffer, uint32_t value) {
+	return std::to_chars(buffer, buffer + NUMBER_SIZE, value).ptr;
+}
+
+}// namespace format
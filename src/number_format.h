@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace format {
+
+// Буфер такого размера вмещает запись любого числа
+inline constexpr size_t NUMBER_SIZE = 32;
+
+// Число записывается как в std::ostream с настройками по умолчанию (double - %g с точностью 6),
+// одинаково для JSON и SVG. Пишут в buffer размером NUMBER_SIZE и возвращают конец записи.
+char* WriteNumber(char* buffer, double value);
+char* WriteNumber(char* buffer, int value);
+char* WriteNumber(char* buffer, uint32_t value);
+
+}// namespace format
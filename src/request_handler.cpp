@@ -1,4 +1,7 @@
 #include "request_handler.h"
+#include "shards.h"
+
+#include <sstream>
 
 namespace location {
 namespace input {
@@ -10,61 +13,207 @@ void RequestHandler::AddRequest(int id, std::string_view type, std::string_view
 	stat_requests_.push_back({id, type_str, name_str, opt_str});
 }
 
-json::Node RequestHandler::Result() const {
-	using namespace std::literals;
-	json::Builder request_result;
+void RequestHandler::AddNearbyRequest(int id, geo::Coordinates coordinates, std::optional<double> radius, std::optional<int> count) {
+	stat_requests_.push_back({id, "Nearby", {}, {}, coordinates, radius, count});
+}
+
+void RequestHandler::AddStopSearchRequest(int id, std::string_view prefix, int count, bool fuzzy) {
+	Request request{id, "StopSearch", std::string(prefix), {}};
+	request.count = count;
+	request.fuzzy = fuzzy;
+	stat_requests_.push_back(std::move(request));
+}
+
+void RequestHandler::AddMapTileRequest(int id, const TileArea& area) {
+	Request request{id, "MapTile", {}, {}};
+	request.tile = area;
+	stat_requests_.push_back(std::move(request));
+}
+
+RequestHandler::RequestHandler(TransportCatalogue& transport_catalog, svg::output::MapRenderer& renderer, graph::TransportRouter& transport_router)
+	: transport_catalog_(transport_catalog), renderer_(renderer), transport_router_(transport_router) { }
+
+RequestHandler::~RequestHandler() = default;
+
+json::Node RequestHandler::Result(std::pmr::memory_resource* resource) const {
+	json::NodeBuilder builder(resource);
+	json::Writer request_result(builder);
+	WriteResult(request_result);
+	return builder.Extract();
+}
+
+void RequestHandler::PrintResult(std::ostream& output) const {
+	json::Printer printer(output, compact_output_);
+	json::Writer request_result(printer);
+	WriteResult(request_result);
+}
+
+void RequestHandler::WriteResult(json::Writer& request_result) const {
 	request_result.StartArray();
 	for (const Request& item : stat_requests_) {
-		if (item.type == "Bus") {
-			RouteData result = transport_catalog_.GetRouteInformation(item.name);
-			request_result.StartDict();
-			if (!result.route_number.empty()) {
-				request_result.Key("curvature"s).Value(result.curvature);
-				request_result.Key("request_id"s).Value(item.id);
-				request_result.Key("route_length"s).Value(result.length);
-				request_result.Key("stop_count"s).Value(result.stops_num);
-				request_result.Key("unique_stop_count"s).Value(result.unique_stops_num);
-			} else {
-				request_result.Key("error_message"s).Value("not found"s);
-				request_result.Key("request_id"s).Value(item.id);
-			}
-			request_result.EndDict();
+		AnswerRequest(item, request_result);
+	}
+	request_result.EndArray();
+}
+
+void RequestHandler::PrintResultLines(std::ostream& output) {
+	// ответ собирается в строку и выводится, только если получен целиком
+	std::ostringstream line;
+	for (const Request& item : stat_requests_) {
+		line.str({});
+		try {
+			json::Printer printer(line, true);
+			json::Writer request_result(printer);
+			AnswerRequest(item, request_result);
+		} catch (const std::exception& e) {
+			PrintErrorLine(output, e.what(), item.id);
+			continue;
 		}
+		line.put('\n');
+		output << line.str();
+	}
+	stat_requests_.clear();
+	output.flush();
+}
 
-		if (item.type == "Stop") {
-			const Stop* result = transport_catalog_.FindStop(item.name);
-			request_result.StartDict();
-			if (result) {
-				request_result.Key("buses"s).StartArray();
-				std::set<std::string>* routes = transport_catalog_.FindAvailableRoutes(item.name);
-				if (routes != nullptr) { // откуда-то взялась вероятность получить тут пустоту при сериализации или десериализации
-					for (std::string item : *routes) {
-						request_result.Value(item);
-					}
-				}
-				request_result.EndArray();
-			} else {
-				request_result.Key("error_message"s).Value("not found"s);
-			}
-			request_result.Key("request_id"s).Value(item.id);
-			request_result.EndDict();
+void RequestHandler::PrintErrorLine(std::ostream& output, std::string_view message, std::optional<int> id) {
+	using namespace std::literals;
+	{
+		json::Printer printer(output, true);
+		json::Writer error(printer);
+		error.StartDict().Key("error_message"s).Value(message);
+		if (id) {
+			error.Key("request_id"s).Value(*id);
 		}
+		error.EndDict();
+	}
+	output.put('\n');
+}
 
-		if (item.type == "Map") {
-			request_result.StartDict();
-			request_result.Key("map"s).Value(renderer_.RenderMap(transport_catalog_).AsString());
-			request_result.Key("request_id"s).Value(item.id);
-			request_result.EndDict();
+void RequestHandler::AnswerRequest(const Request& item, json::Writer& request_result) const {
+	// карта разбитой базы хранится в индексе, части для неё не загружаются
+	if (shards_ && !(item.type == "Map" && map_)) {
+		shards_->RequestResult(item, request_result);
+	} else {
+		RequestResult(item, request_result);
+	}
+}
+
+void RequestHandler::RequestResult(const Request& item, json::Writer& request_result) const {
+	if (item.type == "Bus") {
+		BusResult(item, request_result);
+	}
+	if (item.type == "Stop") {
+		StopResult(item, request_result);
+	}
+	if (item.type == "Map") {
+		MapResult(item, request_result);
+	}
+	if (item.type == "MapTile") {
+		MapTileResult(item, request_result);
+	}
+	if (item.type == "Nearby") {
+		NearbyResult(item, request_result);
+	}
+	if (item.type == "StopSearch") {
+		StopSearchResult(item, request_result);
+	}
+	if (item.type == "Route") {
+		RouteResult(item, request_result);
+	}
+}
+
+void RequestHandler::BusResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	RouteData result = transport_catalog_.GetRouteInformation(item.name);
+	request_result.StartDict();
+	if (!result.route_number.empty()) {
+		request_result.Key("curvature"s).Value(result.curvature);
+		request_result.Key("request_id"s).Value(item.id);
+		request_result.Key("route_length"s).Value(result.length);
+		request_result.Key("stop_count"s).Value(result.stops_num);
+		request_result.Key("unique_stop_count"s).Value(result.unique_stops_num);
+	} else {
+		request_result.Key("error_message"s).Value("not found"s);
+		request_result.Key("request_id"s).Value(item.id);
+	}
+	request_result.EndDict();
+}
+
+void RequestHandler::StopResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	const Stop* result = transport_catalog_.FindStop(item.name);
+	request_result.StartDict();
+	if (result) {
+		request_result.Key("buses"s).StartArray();
+		for (uint32_t bus_id : transport_catalog_.FindAvailableRoutes(item.name)) {
+			request_result.Value(transport_catalog_.GetRoutes()[bus_id].route_number);
 		}
-		if (item.type == "Route") {
-			request_result.StartDict();
-			request_result.Key("request_id"s).Value(item.id);
-			transport_router_.CalculateRoute(item.name, item.opt_str, request_result);
-			request_result.EndDict();
+		request_result.EndArray();
+	} else {
+		request_result.Key("error_message"s).Value("not found"s);
+	}
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.EndDict();
+}
+
+void RequestHandler::MapResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	request_result.StartDict();
+	request_result.Key("map"s).Value(GetMap());
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.EndDict();
+}
+
+void RequestHandler::MapTileResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	request_result.StartDict();
+	request_result.Key("map"s).Value(renderer_.RenderTile(GetMapLayout(), item.tile));
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.EndDict();
+}
+
+void RequestHandler::NearbyResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	std::vector<NearbyStop> found;
+	if (item.count) {
+		found = transport_catalog_.FindNearestStops(item.coordinates, std::max(*item.count, 0));
+		if (item.radius) {
+			double radius = *item.radius;
+			found.erase(std::find_if(found.begin(), found.end(), [radius](const NearbyStop& near) {
+				return near.distance > radius;
+			}), found.end());
 		}
+	} else {
+		found = transport_catalog_.FindStopsInRadius(item.coordinates, *item.radius);
+	}
+	request_result.StartDict();
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.Key("stops"s).StartArray();
+	for (const NearbyStop& near : found) {
+		request_result.StartDict();
+		request_result.Key("distance"s).Value(near.distance);
+		request_result.Key("name"s).Value(near.stop->name);
+		request_result.EndDict();
+	}
+	request_result.EndArray();
+	request_result.EndDict();
+}
+
+void RequestHandler::StopSearchResult(const Request& item, json::Writer& request_result) const {
+	using namespace std::literals;
+	request_result.StartDict();
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.Key("stops"s).StartArray();
+	for (const Stop* stop : transport_catalog_.FindStopsByPrefix(item.name, std::max(*item.count, 0), item.fuzzy)) {
+		request_result.Value(stop->name);
 	}
 	request_result.EndArray();
-	return request_result.Build();
+	request_result.EndDict();
+}
+
+void RequestHandler::RouteResult(const Request& item, json::Writer& request_result) const {
+	transport_router_.CalculateRoute(item.name, item.opt_str, item.id, request_result);
 }
 
 void RequestHandler::AddSerializationFilename(std::string_view name) {
@@ -77,7 +226,27 @@ void RequestHandler::AddDeserializationFilename(std::string_view name) {
 	deserialization_filename = std::move(name_str);
 }
 
+void RequestHandler::SetShardsCount(size_t shards_count) {
+	shards_count_ = std::max<size_t>(1, shards_count);
+}
+
+void RequestHandler::SetCompactCoordinates(bool compact_coordinates) {
+	compact_coordinates_ = compact_coordinates;
+}
+
+void RequestHandler::SetCompactOutput(bool compact_output) {
+	compact_output_ = compact_output;
+}
+
+void RequestHandler::SetShardToBuild(size_t shard) {
+	shard_to_build_ = shard;
+}
+
 void RequestHandler::Save() {
+	if (shards_count_ > 1) {
+		SaveShards();
+		return;
+	}
 	std::ofstream fout(serialization_filename, std::ios::binary);
 	Serialization(fout);
 	fout.close();
@@ -89,82 +258,177 @@ void RequestHandler::Load() {
 	fin.close();
 }
 
+void RequestHandler::LoadForUpdate() {
+	std::fstream fin(deserialization_filename, std::ios::in | std::ios::binary);
+	loaded_base_.ParseFromIstream(&fin);
+	fin.close();
+	if (loaded_base_.has_shards_index()) {
+		throw std::invalid_argument("update_base does not support sharded bases");
+	}
+	compact_coordinates_ = loaded_base_.catalog_data().stops_list().lat_delta_size() > 0;
+	DeserializationTransportCatalog(loaded_base_.catalog_data());
+	DeserializationRenderSettings(loaded_base_.render_settings());
+}
+
+void RequestHandler::SaveUpdate(const BaseChanges& changes) {
+	// удаление остановки сдвигает id, на которые ссылаются маршруты и расстояния
+	transport_catalogue_serialize::CatalogData* catalog_data = loaded_base_.mutable_catalog_data();
+	if (changes.stops) {
+		*catalog_data->mutable_stops_list() = StopListSerialization();
+		*catalog_data->mutable_stop_names_index() = serialization::NameIndexSerialization(transport_catalog_.GetNamesIndex());
+	}
+	if (changes.stops || changes.buses) {
+		*catalog_data->mutable_buses_list() = BusesListSerialization();
+		*catalog_data->mutable_stops_buses_index() = StopsBusesIndexSerialization();
+	}
+	if (changes.stops || changes.distances) {
+		*catalog_data->mutable_distances_list() = DistancesListSerialization();
+	}
+	if (changes.stops || changes.buses) {
+		loaded_base_.set_map(renderer_.RenderMap(transport_catalog_));
+	}
+	std::ofstream fout(serialization_filename, std::ios::binary);
+	loaded_base_.SerializeToOstream(&fout);
+	fout.close();
+}
 
 //   -----------------------private-----------------------
 
-void RequestHandler::Serialization(std::ostream& out_str) const {
+void RequestHandler::SaveShards() const {
+	const shards::ShardsPlan plan = shards::PlanShards(transport_catalog_, shards_count_);
+	if (shard_to_build_ && *shard_to_build_ >= plan.count) {
+		throw std::out_of_range("Shard " + std::to_string(*shard_to_build_) + " is out of range");
+	}
+	// индекс частей пишется вместе с нулевой частью, чтобы отдельные процессы не перезаписывали его
+	if (!shard_to_build_ || *shard_to_build_ == 0) {
+		transport_catalogue_serialize::TransportCatalogue index_data;
+		*index_data.mutable_shards_index() = shards::MakeShardsIndex(transport_catalog_, plan, serialization_filename);
+		*index_data.mutable_routing_settings() = RoutingSettingsSerialization();
+		*index_data.mutable_render_settings() = RenderSettingsSerialization();
+		index_data.set_map(GetMap());
+		std::ofstream fout(serialization_filename, std::ios::binary);
+		index_data.SerializeToOstream(&fout);
+		fout.close();
+	}
+	for (uint32_t shard = 0; shard < plan.count; ++shard) {
+		if (shard_to_build_ && *shard_to_build_ != shard) {
+			continue;
+		}
+		TransportCatalogue shard_catalog;
+		shards::FillShard(transport_catalog_, plan, shard, shard_catalog);
+		RequestHandler shard_handler(shard_catalog, renderer_, transport_router_);
+		shard_handler.SetCompactCoordinates(compact_coordinates_);
+		std::ofstream fout(shards::ShardFilename(serialization_filename, shard), std::ios::binary);
+		shard_handler.Serialization(fout, false);
+		fout.close();
+	}
+}
+
+const std::string& RequestHandler::GetMap() const {
+	if (!map_) {
+		map_ = renderer_.RenderMap(transport_catalog_);
+	}
+	return *map_;
+}
+
+const svg::output::MapLayout& RequestHandler::GetMapLayout() const {
+	if (!map_layout_) {
+		map_layout_ = std::make_unique<svg::output::MapLayout>(renderer_.BuildLayout(transport_catalog_));
+	}
+	return *map_layout_;
+}
+
+void RequestHandler::Serialization(std::ostream& out_str, bool with_map) const {
 	transport_catalogue_serialize::TransportCatalogue setialized_data;
 	*setialized_data.mutable_catalog_data() = TransportCatalogSerialization();
 	*setialized_data.mutable_routing_settings() = RoutingSettingsSerialization();
 	*setialized_data.mutable_render_settings() = RenderSettingsSerialization();
+	if (with_map) {
+		setialized_data.set_map(GetMap());
+	}
 	setialized_data.SerializeToOstream(&out_str);
 }
 
 void RequestHandler::Deserialization(std::istream& input_st) {
 	transport_catalogue_serialize::TransportCatalogue setialized_data;
 	setialized_data.ParseFromIstream(&input_st);
+	if (!setialized_data.map().empty()) {
+		map_ = std::move(*setialized_data.mutable_map());
+	}
+	if (setialized_data.has_shards_index()) {
+		shards_ = std::make_unique<shards::Coordinator>(setialized_data.shards_index());
+		return;
+	}
 	DeserializationTransportCatalog(setialized_data.catalog_data());
 	DeserializationRoutingSettings(setialized_data.routing_settings());
 	DeserializationRenderSettings(setialized_data.render_settings());
 }
 
-transport_catalogue_serialize::StopsList RequestHandler::StopListSerialization(std::map<std::string, int>& stops_pointer) const {
-	int num_pointer = 0;
+transport_catalogue_serialize::StopsList RequestHandler::StopListSerialization() const {
 	transport_catalogue_serialize::StopsList stop_list;
+	geo::FixedCoordinates previous{0, 0};
 	for (auto& stop_item : transport_catalog_.GetStops()) {
-		transport_catalogue_serialize::Coordinates coordinates;
-		coordinates.set_lat(stop_item.coordinates.lat);
-		coordinates.set_lng(stop_item.coordinates.lng);
 		transport_catalogue_serialize::Stop stop;
 		stop.set_name(stop_item.name);
-		*stop.mutable_coordinates() = coordinates;
-		stop.set_id(num_pointer);
-		transport_catalogue_serialize::AvailableRoutes aviable_routes;
-		if (!transport_catalog_.FindAvailableRoutes(stop_item.name)->empty()) {
-			aviable_routes.set_id_form(num_pointer);
-			for (auto& element : *transport_catalog_.FindAvailableRoutes(stop_item.name)) {
-				aviable_routes.add_route(element);
-			}
-			*stop.mutable_aviable_routes() = aviable_routes;
+		if (compact_coordinates_) {
+			const geo::FixedCoordinates current = geo::ToFixed(stop_item.coordinates);
+			stop_list.add_lat_delta(current.lat - previous.lat);
+			stop_list.add_lng_delta(current.lng - previous.lng);
+			previous = current;
+		} else {
+			transport_catalogue_serialize::Coordinates coordinates;
+			coordinates.set_lat(stop_item.coordinates.lat);
+			coordinates.set_lng(stop_item.coordinates.lng);
+			*stop.mutable_coordinates() = coordinates;
 		}
+		stop.set_id(stop_item.id);
 		*stop_list.add_stops() = stop;
-		stops_pointer.insert({stop_item.name, num_pointer++});
 	}
 	return stop_list;
 }
 
-transport_catalogue_serialize::BusesList RequestHandler::BusesListSerialization(std::map<std::string, int>& stops_pointer) const {
+transport_catalogue_serialize::BusesList RequestHandler::BusesListSerialization() const {
 	transport_catalogue_serialize::BusesList buses_list;
 	for (auto& bus_item : transport_catalog_.GetRoutes()) {
 		transport_catalogue_serialize::Bus bus;
 		bus.set_route_number(bus_item.route_number);
 		bus.set_is_circular(bus_item.is_circular);
 		for (auto& stop_ptr : bus_item.route_stops) {
-			bus.add_stop_id(stops_pointer.at(stop_ptr->name));
+			bus.add_stop_id(stop_ptr->id);
 		}
 		*buses_list.add_bus() = bus;
 	}
 	return buses_list;
 }
 
-transport_catalogue_serialize::DistancesList RequestHandler::DistancesListSerialization(std::map<std::string, int>& stops_pointer) const {
+transport_catalogue_serialize::DistancesList RequestHandler::DistancesListSerialization() const {
 	transport_catalogue_serialize::DistancesList distances_list;
 	for (auto& [stop_pair, distance] : *transport_catalog_.GetDistances()) {
 		transport_catalogue_serialize::StopsDistance stop_distance;
-		stop_distance.set_id_form(stops_pointer.at(stop_pair.first->name));
-		stop_distance.set_id_to(stops_pointer.at(stop_pair.second->name));
+		stop_distance.set_id_form(stop_pair.first->id);
+		stop_distance.set_id_to(stop_pair.second->id);
 		stop_distance.set_distance(distance);
 		*distances_list.add_distances() = stop_distance;
 	}
 	return distances_list;
 }
 
+transport_catalogue_serialize::StopsBusesIndex RequestHandler::StopsBusesIndexSerialization() const {
+	transport_catalogue_serialize::StopsBusesIndex stops_buses_index;
+	const std::vector<uint32_t>& offsets = transport_catalog_.GetStopBusesOffsets();
+	const std::vector<uint32_t>& bus_ids = transport_catalog_.GetStopBuses();
+	stops_buses_index.mutable_offsets()->Add(offsets.begin(), offsets.end());
+	stops_buses_index.mutable_bus_id()->Add(bus_ids.begin(), bus_ids.end());
+	return stops_buses_index;
+}
+
 transport_catalogue_serialize::CatalogData RequestHandler::TransportCatalogSerialization() const {
-		std::map<std::string, int> stops_pointer;
 		transport_catalogue_serialize::CatalogData catalog_data;
-		*catalog_data.mutable_stops_list() = StopListSerialization(stops_pointer);
-		*catalog_data.mutable_buses_list() = BusesListSerialization(stops_pointer);
-		*catalog_data.mutable_distances_list() = DistancesListSerialization(stops_pointer);
+		*catalog_data.mutable_stops_list() = StopListSerialization();
+		*catalog_data.mutable_buses_list() = BusesListSerialization();
+		*catalog_data.mutable_distances_list() = DistancesListSerialization();
+		*catalog_data.mutable_stops_buses_index() = StopsBusesIndexSerialization();
+		*catalog_data.mutable_stop_names_index() = serialization::NameIndexSerialization(transport_catalog_.GetNamesIndex());
 		return catalog_data;
 	}
 
@@ -225,18 +489,23 @@ transport_catalogue_serialize::RenderSettings RequestHandler::RenderSettingsSeri
 }
 
 void RequestHandler::DeserializationStopsList(transport_catalogue_serialize::StopsList stop_list, std::map<int, std::string>& stops_pointer) {
+	const bool compact = stop_list.lat_delta_size() == stop_list.stops_size() && stop_list.lng_delta_size() == stop_list.stops_size()
+			&& stop_list.stops_size() > 0;
+	geo::FixedCoordinates fixed{0, 0};
 	for (int i = 0; i < stop_list.stops_size(); ++i) {
 		transport_catalogue_serialize::Stop stop_serialized = stop_list.stops(i);
 		stops_pointer.insert({stop_serialized.id(), stop_serialized.name()});
-		transport_catalogue_serialize::Coordinates coordinates_serialized = stop_serialized.coordinates();
-		geo::Coordinates coordinates({coordinates_serialized.lat(), coordinates_serialized.lng()});
-		location::Stop stop({stop_serialized.name(), coordinates});
-		transport_catalogue_serialize::AvailableRoutes aviable_routes = stop_serialized.aviable_routes();
-		std::set<std::string> aviable_routes_set;
-		for (int i = 0; i < aviable_routes.route_size(); ++i) {
-			aviable_routes_set.insert(std::move(aviable_routes.route(i)));
+		geo::Coordinates coordinates;
+		if (compact) {
+			fixed.lat += stop_list.lat_delta(i);
+			fixed.lng += stop_list.lng_delta(i);
+			coordinates = geo::FromFixed(fixed);
+		} else {
+			transport_catalogue_serialize::Coordinates coordinates_serialized = stop_serialized.coordinates();
+			coordinates = {coordinates_serialized.lat(), coordinates_serialized.lng()};
 		}
-		transport_catalog_.AddDeserializedStop(stop, aviable_routes_set);
+		location::Stop stop({stop_serialized.name(), coordinates});
+		transport_catalog_.AddDeserializedStop(stop);
 	}
 }
 
@@ -262,11 +531,21 @@ void RequestHandler::DeserializationDistancesList(transport_catalogue_serialize:
 	}
 }
 
+void RequestHandler::DeserializationStopsBusesIndex(const transport_catalogue_serialize::StopsBusesIndex& stops_buses_index) {
+	std::vector<uint32_t> offsets(stops_buses_index.offsets().begin(), stops_buses_index.offsets().end());
+	std::vector<uint32_t> bus_ids(stops_buses_index.bus_id().begin(), stops_buses_index.bus_id().end());
+	transport_catalog_.AddDeserializedStopsIndex(std::move(offsets), std::move(bus_ids));
+}
+
 void RequestHandler::DeserializationTransportCatalog(transport_catalogue_serialize::CatalogData catalog_data) {
 	std::map<int, std::string> stops_pointer;
 	DeserializationStopsList(catalog_data.stops_list(), stops_pointer);
+	transport_catalog_.BuildSpatialIndex();
 	DeserializationBusesList(catalog_data.buses_list(), stops_pointer);
 	DeserializationDistancesList(catalog_data.distances_list(), stops_pointer);
+	transport_catalog_.BuildRoutesDistances();
+	DeserializationStopsBusesIndex(catalog_data.stops_buses_index());
+	transport_catalog_.AddDeserializedNamesIndex(serialization::NameIndexDeserialization(catalog_data.stop_names_index()));
 }
 
 void RequestHandler::DeserializationRoutingSettings(transport_catalogue_serialize::RoutingSettings routing_settings) {
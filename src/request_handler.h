@@ -1,7 +1,7 @@
 #pragma once
 
 #include "json.h"
-#include "json_builder.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "router.h"
 #include "transport_catalogue.h"
@@ -9,22 +9,45 @@
 #include "transport_router.h"
 #include "serialization.h"
 
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <fstream>
 #include <unordered_set>
 
 
 namespace location {
+namespace shards {
+class Coordinator;
+}// namespace shards
+
 namespace input {
 
+struct BaseChanges {
+	bool stops = false;
+	bool buses = false;
+	bool distances = false;
+};
+
 class RequestHandler {
 public:
-	RequestHandler(TransportCatalogue& transport_catalog, svg::output::MapRenderer& renderer, graph::TransportRouter& transport_router)
-		: transport_catalog_(transport_catalog), renderer_(renderer), transport_router_(transport_router) { }
+	RequestHandler(TransportCatalogue& transport_catalog, svg::output::MapRenderer& renderer, graph::TransportRouter& transport_router);
+	~RequestHandler();
 
 	void AddRequest(int id, std::string_view type, std::string_view name, std::string_view opt_str);
+	void AddNearbyRequest(int id, geo::Coordinates coordinates, std::optional<double> radius, std::optional<int> count);
+	void AddStopSearchRequest(int id, std::string_view prefix, int count, bool fuzzy);
+	void AddMapTileRequest(int id, const TileArea& area);
 	void AddSerializationFilename(std::string_view name);
 	void AddDeserializationFilename(std::string_view name);
+	// При shards_count > 1 make_base сохраняет индекс и по файлу базы на каждую часть каталога
+	void SetShardsCount(size_t shards_count);
+	// Координаты в базе хранятся в миллионных долях градуса разностями с предыдущей остановкой
+	void SetCompactCoordinates(bool compact_coordinates);
+	// Ответ process_requests выводится одной строкой без отступов
+	void SetCompactOutput(bool compact_output);
+	// Ограничивает make_base одной частью, чтобы части можно было собирать отдельными процессами
+	void SetShardToBuild(size_t shard);
 
 	graph::TransportRouter& GetTransportRouter() {
 		return transport_router_;
@@ -33,7 +56,30 @@ public:
 	void Save();
 	void Load();
 
-	json::Node Result() const;
+	// Режим update_base: загружается только каталог, настройки остаются в исходном виде,
+	// при сохранении заново формируются лишь затронутые изменениями разделы базы
+	void LoadForUpdate();
+	void SaveUpdate(const BaseChanges& changes);
+
+	// Узлы ответа размещаются в resource, который должен пережить результат
+	json::Node Result(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+	// Выводит ответ в output по мере обработки запросов, не собирая его целиком
+	void PrintResult(std::ostream& output) const;
+	void WriteResult(json::Writer& request_result) const;
+	// Выводит ответ на каждый накопленный запрос отдельной строкой без отступов и забывает запросы.
+	// Если ответить на запрос не удалось, вместо ответа выводится строка с ошибкой
+	void PrintResultLines(std::ostream& output);
+	// Строка {"error_message": ..., "request_id": id}; request_id выводится, если id известен
+	static void PrintErrorLine(std::ostream& output, std::string_view message, std::optional<int> id);
+
+	void RequestResult(const Request& item, json::Writer& request_result) const;
+	void BusResult(const Request& item, json::Writer& request_result) const;
+	void StopResult(const Request& item, json::Writer& request_result) const;
+	void MapResult(const Request& item, json::Writer& request_result) const;
+	void MapTileResult(const Request& item, json::Writer& request_result) const;
+	void NearbyResult(const Request& item, json::Writer& request_result) const;
+	void StopSearchResult(const Request& item, json::Writer& request_result) const;
+	void RouteResult(const Request& item, json::Writer& request_result) const;
 
 private:
 	location::TransportCatalogue& transport_catalog_;
@@ -42,12 +88,29 @@ private:
 	std::vector<Request> stat_requests_;
 	std::string serialization_filename;
 	std::string deserialization_filename;
-
-	void Serialization(std::ostream& out_str) const;
-
-	transport_catalogue_serialize::StopsList StopListSerialization(std::map<std::string, int>& stops_pointer) const;
-	transport_catalogue_serialize::BusesList BusesListSerialization(std::map<std::string, int>& stops_pointer) const;
-	transport_catalogue_serialize::DistancesList DistancesListSerialization(std::map<std::string, int>& stops_pointer) const;
+	transport_catalogue_serialize::TransportCatalogue loaded_base_;
+	bool compact_coordinates_ = false;
+	bool compact_output_ = false;
+	size_t shards_count_ = 1;
+	std::optional<size_t> shard_to_build_;
+	std::unique_ptr<shards::Coordinator> shards_;
+	// карта зависит только от базы и render_settings: она отрисовывается в make_base, а для базы без неё -
+	// при первом запросе Map
+	mutable std::optional<std::string> map_;
+	// индекс элементов карты для MapTile строится при первом таком запросе
+	mutable std::unique_ptr<svg::output::MapLayout> map_layout_;
+
+	void SaveShards() const;
+	const std::string& GetMap() const;
+	const svg::output::MapLayout& GetMapLayout() const;
+	void AnswerRequest(const Request& item, json::Writer& request_result) const;
+
+	void Serialization(std::ostream& out_str, bool with_map = true) const;
+
+	transport_catalogue_serialize::StopsList StopListSerialization() const;
+	transport_catalogue_serialize::BusesList BusesListSerialization() const;
+	transport_catalogue_serialize::DistancesList DistancesListSerialization() const;
+	transport_catalogue_serialize::StopsBusesIndex StopsBusesIndexSerialization() const;
 	transport_catalogue_serialize::CatalogData TransportCatalogSerialization() const;
 	transport_catalogue_serialize::RoutingSettings RoutingSettingsSerialization() const;
 	inline transport_catalogue_serialize::Color ColorSerialization(svg::Color& input_color) const;
@@ -58,6 +121,7 @@ private:
 	void DeserializationStopsList(transport_catalogue_serialize::StopsList stop_list, std::map<int, std::string>& stops_pointer);
 	void DeserializationBusesList(transport_catalogue_serialize::BusesList buses_list, std::map<int, std::string>& stops_pointer);
 	void DeserializationDistancesList(transport_catalogue_serialize::DistancesList distances_list, std::map<int, std::string>& stops_pointer);
+	void DeserializationStopsBusesIndex(const transport_catalogue_serialize::StopsBusesIndex& stops_buses_index);
 	void DeserializationTransportCatalog(transport_catalogue_serialize::CatalogData catalog_data);
 	void DeserializationRoutingSettings(transport_catalogue_serialize::RoutingSettings routing_settings);
 	inline svg::Color DeserializationColor(transport_catalogue_serialize::Color color_serialized);
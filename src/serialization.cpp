@@ -1 +1,28 @@
 #include "serialization.h"
+
+namespace location {
+namespace serialization {
+
+transport_catalogue_serialize::StopNamesIndex NameIndexSerialization(const NameIndex& names_index) {
+	transport_catalogue_serialize::StopNamesIndex names_index_serialized;
+	names_index_serialized.mutable_child_offsets()->Add(names_index.GetChildOffsets().begin(), names_index.GetChildOffsets().end());
+	names_index_serialized.mutable_label()->Add(names_index.GetLabels().begin(), names_index.GetLabels().end());
+	names_index_serialized.mutable_first()->Add(names_index.GetFirst().begin(), names_index.GetFirst().end());
+	names_index_serialized.mutable_last()->Add(names_index.GetLast().begin(), names_index.GetLast().end());
+	names_index_serialized.mutable_stop_id()->Add(names_index.GetIds().begin(), names_index.GetIds().end());
+	return names_index_serialized;
+}
+
+NameIndex NameIndexDeserialization(const transport_catalogue_serialize::StopNamesIndex& names_index_serialized) {
+	NameIndex names_index;
+	names_index.Assign(
+			{names_index_serialized.child_offsets().begin(), names_index_serialized.child_offsets().end()},
+			{names_index_serialized.label().begin(), names_index_serialized.label().end()},
+			{names_index_serialized.first().begin(), names_index_serialized.first().end()},
+			{names_index_serialized.last().begin(), names_index_serialized.last().end()},
+			{names_index_serialized.stop_id().begin(), names_index_serialized.stop_id().end()});
+	return names_index;
+}
+
+}// namespace serialization
+}// namespace location
@@ -1,2 +1,14 @@
 #pragma once
 
+#include "name_index.h"
+#include <transport_catalogue.pb.h>
+
+namespace location {
+namespace serialization {
+
+// Префиксное дерево названий хранится и в базе каталога, и в индексе частей
+transport_catalogue_serialize::StopNamesIndex NameIndexSerialization(const NameIndex& names_index);
+NameIndex NameIndexDeserialization(const transport_catalogue_serialize::StopNamesIndex& names_index_serialized);
+
+}// namespace serialization
+}// namespace location
@@ -0,0 +1,339 @@
+#include "shards.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace location {
+namespace shards {
+
+using namespace std::literals;
+
+namespace {
+
+bool InShard(const std::vector<uint32_t>& shards, uint32_t shard) {
+	return std::binary_search(shards.begin(), shards.end(), shard);
+}
+
+void NotFound(const Request& item, json::Writer& request_result) {
+	request_result.StartDict();
+	request_result.Key("error_message"s).Value("not found"s);
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.EndDict();
+}
+
+}// namespace
+
+ShardsPlan PlanShards(const TransportCatalogue& transport_catalog, size_t count) {
+	const std::deque<Stop>& stops = transport_catalog.GetStops();
+	const std::deque<Bus>& buses = transport_catalog.GetRoutes();
+	ShardsPlan plan;
+	plan.count = std::max<size_t>(1, std::min(count, stops.size()));
+
+	std::vector<uint32_t> order(stops.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&stops](uint32_t lhs, uint32_t rhs) {
+		return std::make_pair(stops[lhs].coordinates.lng, lhs) < std::make_pair(stops[rhs].coordinates.lng, rhs);
+	});
+	std::vector<uint32_t> stop_owner(stops.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		stop_owner[order[i]] = static_cast<uint32_t>(i * plan.count / order.size());
+	}
+
+	plan.stop_shards.resize(stops.size());
+	for (uint32_t id = 0; id < stops.size(); ++id) {
+		plan.stop_shards[id].push_back(stop_owner[id]);
+	}
+	plan.bus_owner.resize(buses.size(), 0);
+	std::vector<size_t> votes(plan.count);
+	for (const Bus& bus : buses) {
+		std::fill(votes.begin(), votes.end(), 0);
+		for (const Stop* stop : bus.route_stops) {
+			++votes[stop_owner[stop->id]];
+		}
+		const uint32_t owner = static_cast<uint32_t>(std::max_element(votes.begin(), votes.end()) - votes.begin());
+		plan.bus_owner[bus.id] = owner;
+		for (const Stop* stop : bus.route_stops) {
+			plan.stop_shards[stop->id].push_back(owner);
+		}
+	}
+	for (std::vector<uint32_t>& shards : plan.stop_shards) {
+		std::sort(shards.begin(), shards.end());
+		shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+	}
+	return plan;
+}
+
+void FillShard(const TransportCatalogue& transport_catalog, const ShardsPlan& plan, uint32_t shard, TransportCatalogue& shard_catalog) {
+	for (const Stop& stop : transport_catalog.GetStops()) {
+		if (InShard(plan.stop_shards[stop.id], shard)) {
+			shard_catalog.AddStop(stop.name, stop.coordinates);
+		}
+	}
+	std::map<std::string_view, std::vector<std::pair<std::string_view, int>>> distances;
+	for (const auto& [stops_pair, distance] : *transport_catalog.GetDistances()) {
+		if (InShard(plan.stop_shards[stops_pair.first->id], shard) && InShard(plan.stop_shards[stops_pair.second->id], shard)) {
+			distances[stops_pair.first->name].push_back({stops_pair.second->name, distance});
+		}
+	}
+	shard_catalog.AddDistances(distances);
+	for (const Bus& bus : transport_catalog.GetRoutes()) {
+		if (plan.bus_owner[bus.id] == shard) {
+			std::vector<std::string_view> stops_list;
+			stops_list.reserve(bus.route_stops.size());
+			for (const Stop* stop : bus.route_stops) {
+				stops_list.push_back(stop->name);
+			}
+			shard_catalog.AddRoute(bus.route_number, bus.is_circular, move(stops_list));
+		}
+	}
+	shard_catalog.BuildStopsIndex();
+	shard_catalog.BuildRoutesDistances();
+	shard_catalog.BuildNamesIndex();
+}
+
+transport_catalogue_serialize::ShardsIndex MakeShardsIndex(const TransportCatalogue& transport_catalog, const ShardsPlan& plan, const std::string& base_filename) {
+	transport_catalogue_serialize::ShardsIndex index;
+	for (uint32_t shard = 0; shard < plan.count; ++shard) {
+		index.add_shard_file(ShardFilename(base_filename, shard));
+	}
+	for (const Stop& stop : transport_catalog.GetStops()) {
+		transport_catalogue_serialize::StopShards* stop_shards = index.add_stops();
+		stop_shards->set_name(stop.name);
+		stop_shards->mutable_shard()->Add(plan.stop_shards[stop.id].begin(), plan.stop_shards[stop.id].end());
+	}
+	for (const Bus& bus : transport_catalog.GetRoutes()) {
+		transport_catalogue_serialize::BusShard* bus_shard = index.add_buses();
+		bus_shard->set_name(bus.route_number);
+		bus_shard->set_shard(plan.bus_owner[bus.id]);
+	}
+	*index.mutable_stop_names_index() = serialization::NameIndexSerialization(transport_catalog.GetNamesIndex());
+	return index;
+}
+
+std::string ShardFilename(const std::string& base_filename, uint32_t shard) {
+	return base_filename + "." + std::to_string(shard);
+}
+
+//--------------------------------- Coordinator ---------------------------------
+
+Coordinator::Coordinator(const transport_catalogue_serialize::ShardsIndex& index)
+	: shard_files_(index.shard_file().begin(), index.shard_file().end())
+	, boundary_stops_(index.shard_file_size())
+	, loaded_(index.shard_file_size()) {
+	for (const transport_catalogue_serialize::StopShards& stop : index.stops()) {
+		auto [iter, inserted] = stop_shards_.emplace(stop.name(), std::vector<uint32_t>(stop.shard().begin(), stop.shard().end()));
+		stop_names_.push_back(iter->first);
+		if (iter->second.size() > 1) {
+			for (uint32_t shard : iter->second) {
+				boundary_stops_.at(shard).push_back(iter->first);
+			}
+		}
+	}
+	for (const transport_catalogue_serialize::BusShard& bus : index.buses()) {
+		bus_shard_.emplace(bus.name(), bus.shard());
+	}
+	names_index_ = serialization::NameIndexDeserialization(index.stop_names_index());
+	if (names_index_.GetIds().size() != stop_names_.size()) {
+		names_index_.Build(stop_names_);
+	}
+}
+
+void Coordinator::RequestResult(const Request& item, json::Writer& request_result) {
+	if (item.type == "Bus") {
+		auto iter = bus_shard_.find(item.name);
+		if (iter == bus_shard_.end()) {
+			NotFound(item, request_result);
+		} else {
+			GetShard(iter->second).handler.BusResult(item, request_result);
+		}
+	}
+	if (item.type == "Stop") {
+		StopResult(item, request_result);
+	}
+	if (item.type == "Map") {
+		GetMerged().handler.MapResult(item, request_result);
+	}
+	if (item.type == "MapTile") {
+		GetMerged().handler.MapTileResult(item, request_result);
+	}
+	if (item.type == "Nearby") {
+		GetMerged().handler.NearbyResult(item, request_result);
+	}
+	if (item.type == "StopSearch") {
+		StopSearchResult(item, request_result);
+	}
+	if (item.type == "Route") {
+		RouteResult(item, request_result);
+	}
+}
+
+Coordinator::Shard& Coordinator::GetShard(uint32_t shard) {
+	if (!loaded_.at(shard)) {
+		loaded_[shard] = std::make_unique<Shard>();
+		loaded_[shard]->handler.AddDeserializationFilename(shard_files_[shard]);
+		loaded_[shard]->handler.Load();
+	}
+	return *loaded_[shard];
+}
+
+Coordinator::Shard& Coordinator::GetMerged() {
+	if (merged_) {
+		return *merged_;
+	}
+	merged_ = std::make_unique<Shard>();
+	TransportCatalogue& merged_catalog = merged_->transport_catalog;
+	for (uint32_t shard = 0; shard < shard_files_.size(); ++shard) {
+		const TransportCatalogue& shard_catalog = GetShard(shard).transport_catalog;
+		for (const Stop& stop : shard_catalog.GetStops()) {
+			if (!merged_catalog.FindStop(stop.name)) {
+				merged_catalog.AddStop(stop.name, stop.coordinates);
+			}
+		}
+	}
+	for (uint32_t shard = 0; shard < shard_files_.size(); ++shard) {
+		const TransportCatalogue& shard_catalog = GetShard(shard).transport_catalog;
+		std::map<std::string_view, std::vector<std::pair<std::string_view, int>>> distances;
+		for (const auto& [stops_pair, distance] : *shard_catalog.GetDistances()) {
+			distances[stops_pair.first->name].push_back({stops_pair.second->name, distance});
+		}
+		merged_catalog.AddDistances(distances);
+		for (const Bus& bus : shard_catalog.GetRoutes()) {
+			std::vector<std::string_view> stops_list;
+			stops_list.reserve(bus.route_stops.size());
+			for (const Stop* stop : bus.route_stops) {
+				stops_list.push_back(stop->name);
+			}
+			merged_catalog.AddRoute(bus.route_number, bus.is_circular, move(stops_list));
+		}
+	}
+	merged_catalog.BuildStopsIndex();
+	merged_catalog.BuildRoutesDistances();
+	merged_catalog.BuildSpatialIndex();
+	if (!shard_files_.empty()) {
+		svg::output::RenderSettings settings = *GetShard(0).renderer.GetSettings();
+		merged_->renderer.InplacedSettings(settings);
+	}
+	return *merged_;
+}
+
+void Coordinator::StopResult(const Request& item, json::Writer& request_result) {
+	auto iter = stop_shards_.find(item.name);
+	if (iter == stop_shards_.end()) {
+		NotFound(item, request_result);
+		return;
+	}
+	// каждый маршрут хранится только в своей части, поэтому объединение списков не даёт повторов
+	std::vector<std::string_view> buses;
+	for (uint32_t shard : iter->second) {
+		const TransportCatalogue& shard_catalog = GetShard(shard).transport_catalog;
+		for (uint32_t bus_id : shard_catalog.FindAvailableRoutes(item.name)) {
+			buses.push_back(shard_catalog.GetRoutes()[bus_id].route_number);
+		}
+	}
+	std::sort(buses.begin(), buses.end());
+	request_result.StartDict();
+	request_result.Key("buses"s).StartArray();
+	for (std::string_view bus : buses) {
+		request_result.Value(bus);
+	}
+	request_result.EndArray();
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.EndDict();
+}
+
+void Coordinator::StopSearchResult(const Request& item, json::Writer& request_result) const {
+	request_result.StartDict();
+	request_result.Key("request_id"s).Value(item.id);
+	request_result.Key("stops"s).StartArray();
+	for (uint32_t id : names_index_.FindByPrefix(item.name, std::max(*item.count, 0), item.fuzzy)) {
+		request_result.Value(stop_names_[id]);
+	}
+	request_result.EndArray();
+	request_result.EndDict();
+}
+
+void Coordinator::RouteResult(const Request& item, json::Writer& request_result) {
+	if (item.name == item.opt_str && stop_shards_.count(item.name)) {
+		GetShard(stop_shards_.at(item.name).front()).handler.RouteResult(item, request_result);
+		return;
+	}
+	if (stop_shards_.count(item.name) && stop_shards_.count(item.opt_str)) {
+		GetShard(stop_shards_.at(item.name).front()).transport_router.PrintRoute(StitchRoute(item.name, item.opt_str), item.id, request_result);
+	} else {
+		NotFound(item, request_result);
+	}
+}
+
+std::optional<graph::RouteResult> Coordinator::StitchRoute(std::string_view from, std::string_view to) {
+	// Любой маршрут - цепочка поездок, каждая внутри части своего автобуса, а пересадка между частями
+	// происходит на общей остановке. Поэтому кратчайший путь ищется Дейкстрой по остановкам на стыке,
+	// где ребро - лучший маршрут внутри одной части. Части подгружаются, когда поиск до них доходит.
+	const std::vector<uint32_t>& target_shards = stop_shards_.at(std::string(to));
+	std::unordered_map<std::string_view, double> best_time;
+	std::unordered_map<std::string_view, std::pair<std::string_view, uint32_t>> previous;
+	using QueueItem = std::pair<double, std::string_view>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+	best_time[from] = 0.0;
+	queue.push({0.0, from});
+	while (!queue.empty()) {
+		const auto [time, stop] = queue.top();
+		queue.pop();
+		if (time > best_time.at(stop)) {
+			continue;
+		}
+		if (stop == to) {
+			break;
+		}
+		for (uint32_t shard : stop_shards_.at(std::string(stop))) {
+			Shard& current = GetShard(shard);
+			auto relax = [&, time = time, stop = stop](std::string_view target) {
+				if (target == stop) {
+					return;
+				}
+				std::optional<graph::RouteResult> leg = current.transport_router.FindRoute(stop, target);
+				if (!leg) {
+					return;
+				}
+				const double candidate = time + leg->total_time;
+				auto iter = best_time.find(target);
+				if (iter == best_time.end() || candidate < iter->second) {
+					best_time[target] = candidate;
+					previous[target] = {stop, shard};
+					queue.push({candidate, target});
+				}
+			};
+			for (std::string_view boundary_stop : boundary_stops_[shard]) {
+				relax(boundary_stop);
+			}
+			if (InShard(target_shards, shard)) {
+				relax(to);
+			}
+		}
+	}
+	if (!best_time.count(to)) {
+		return std::nullopt;
+	}
+	std::vector<std::pair<std::string_view, uint32_t>> legs;
+	for (std::string_view stop = to; stop != from; stop = previous.at(stop).first) {
+		legs.push_back({stop, previous.at(stop).second});
+	}
+	std::reverse(legs.begin(), legs.end());
+	graph::RouteResult result{0.0, {}};
+	std::string_view leg_from = from;
+	for (const auto& [leg_to, shard] : legs) {
+		graph::RouteResult leg = *GetShard(shard).transport_router.FindRoute(leg_from, leg_to);
+		result.total_time += leg.total_time;
+		result.items.insert(result.items.end(), leg.items.begin(), leg.items.end());
+		leg_from = leg_to;
+	}
+	return result;
+}
+
+}// namespace shards
+}// namespace location
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "name_index.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include <transport_catalogue.pb.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace location {
+namespace shards {
+
+// Разбиение каталога на географические части. Остановки делятся на полосы по долготе с равным числом
+// остановок, маршрут принадлежит части, где лежит большинство его остановок. Часть хранит свои маршруты
+// целиком вместе со всеми их остановками, поэтому остановки на стыке входят сразу в несколько частей.
+struct ShardsPlan {
+	size_t count = 1;
+	std::vector<uint32_t> bus_owner;
+	std::vector<std::vector<uint32_t>> stop_shards;
+};
+
+ShardsPlan PlanShards(const TransportCatalogue& transport_catalog, size_t count);
+void FillShard(const TransportCatalogue& transport_catalog, const ShardsPlan& plan, uint32_t shard, TransportCatalogue& shard_catalog);
+transport_catalogue_serialize::ShardsIndex MakeShardsIndex(const TransportCatalogue& transport_catalog, const ShardsPlan& plan, const std::string& base_filename);
+std::string ShardFilename(const std::string& base_filename, uint32_t shard);
+
+// Отвечает на запросы по индексу частей, загружая файлы частей только по мере надобности.
+// Bus и Stop обслуживают части, которым принадлежат маршрут и остановка, Route сшивается
+// из маршрутов внутри частей по остановкам на стыке, Map и Nearby собирают все части вместе.
+// StopSearch отвечает по дереву названий из индекса, не загружая части.
+class Coordinator {
+public:
+	explicit Coordinator(const transport_catalogue_serialize::ShardsIndex& index);
+
+	void RequestResult(const Request& item, json::Writer& request_result);
+
+private:
+	struct Shard {
+		TransportCatalogue transport_catalog;
+		svg::output::MapRenderer renderer;
+		graph::TransportRouter transport_router;
+		input::RequestHandler handler{transport_catalog, renderer, transport_router};
+	};
+
+	std::vector<std::string> shard_files_;
+	std::unordered_map<std::string, std::vector<uint32_t>> stop_shards_;
+	std::unordered_map<std::string, uint32_t> bus_shard_;
+	// названия в порядке индекса частей, на них ссылается names_index_
+	std::vector<std::string_view> stop_names_;
+	NameIndex names_index_;
+	// по номеру части: её остановки, общие с другими частями
+	std::vector<std::vector<std::string_view>> boundary_stops_;
+	std::vector<std::unique_ptr<Shard>> loaded_;
+	std::unique_ptr<Shard> merged_;
+
+	Shard& GetShard(uint32_t shard);
+	Shard& GetMerged();
+
+	void StopResult(const Request& item, json::Writer& request_result);
+	void StopSearchResult(const Request& item, json::Writer& request_result) const;
+	void RouteResult(const Request& item, json::Writer& request_result);
+	std::optional<graph::RouteResult> StitchRoute(std::string_view from, std::string_view to);
+};
+
+}// namespace shards
+}// namespace location
@@ -0,0 +1,264 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace geo {
+
+namespace {
+
+bool CloserThan(const IndexedDistance& lhs, const IndexedDistance& rhs) {
+	return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.id < rhs.id);
+}
+
+}// namespace
+
+void SpatialIndex::Build(const std::vector<PreparedCoordinates>& points) {
+	cell_offsets_.clear();
+	cell_points_.clear();
+	cell_coordinates_.clear();
+	rows_ = cols_ = 0;
+	if (points.empty()) {
+		return;
+	}
+	const auto [bottom_it, top_it] = std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) {
+		return lhs.lat < rhs.lat;
+	});
+	const auto [left_it, right_it] = std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) {
+		return lhs.lng < rhs.lng;
+	});
+	min_lat_ = bottom_it->lat;
+	min_lng_ = left_it->lng;
+	max_lat_ = top_it->lat;
+	max_lng_ = right_it->lng;
+	max_abs_lat_ = std::max(std::abs(bottom_it->lat), std::abs(top_it->lat));
+	// в среднем около одной точки на ячейку
+	const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(points.size())))));
+	rows_ = cols_ = side;
+	const double lat_span = top_it->lat - min_lat_;
+	const double lng_span = right_it->lng - min_lng_;
+	cell_lat_ = lat_span > 0 ? lat_span / rows_ : 1.0;
+	cell_lng_ = lng_span > 0 ? lng_span / cols_ : 1.0;
+
+	std::vector<uint32_t> point_cell(points.size());
+	cell_offsets_.assign(static_cast<size_t>(rows_) * cols_ + 1, 0);
+	for (size_t i = 0; i < points.size(); ++i) {
+		point_cell[i] = static_cast<uint32_t>(RowOf(points[i].lat) * cols_ + ColOf(points[i].lng));
+		++cell_offsets_[point_cell[i] + 1];
+	}
+	for (size_t i = 1; i < cell_offsets_.size(); ++i) {
+		cell_offsets_[i] += cell_offsets_[i - 1];
+	}
+	cell_points_.resize(points.size());
+	cell_coordinates_.resize(points.size());
+	std::vector<uint32_t> fill_pos(cell_offsets_.begin(), cell_offsets_.end() - 1);
+	for (size_t i = 0; i < points.size(); ++i) {
+		const uint32_t pos = fill_pos[point_cell[i]]++;
+		cell_points_[pos] = static_cast<uint32_t>(i);
+		cell_coordinates_[pos] = points[i];
+	}
+}
+
+std::vector<IndexedDistance> SpatialIndex::FindInRadius(Coordinates center, double radius) const {
+	std::vector<IndexedDistance> result;
+	if (Empty() || radius < 0) {
+		return result;
+	}
+	const double lat_delta = radius / (EARTH_RADIUS * DEGREE_TO_RADIAN);
+	const double lat_cos = std::cos(std::min(90.0, std::abs(center.lat) + lat_delta) * DEGREE_TO_RADIAN);
+	const double lng_delta = lat_cos > 1e-9 ? lat_delta / lat_cos : 360.0;
+	const int row_from = RowOf(center.lat - lat_delta);
+	const int row_to = RowOf(center.lat + lat_delta);
+	const int col_from = ColOf(center.lng - lng_delta);
+	const int col_to = ColOf(center.lng + lng_delta);
+	const PreparedCoordinates prepared_center = Prepare(center);
+	for (int row = row_from; row <= row_to; ++row) {
+		for (int col = col_from; col <= col_to; ++col) {
+			ForEachInCell(prepared_center, row, col, [&](uint32_t id, double distance) {
+				if (distance <= radius) {
+					result.push_back({id, distance});
+				}
+			});
+		}
+	}
+	std::sort(result.begin(), result.end(), CloserThan);
+	return result;
+}
+
+std::vector<IndexedDistance> SpatialIndex::FindNearest(Coordinates center, size_t count) const {
+	std::vector<IndexedDistance> result;
+	if (Empty() || count == 0) {
+		return result;
+	}
+	result.reserve(count + 1);
+	// result держится как max-куча: в вершине самый дальний из найденных
+	auto consider = [&](uint32_t id, double distance) {
+		const IndexedDistance candidate{id, distance};
+		if (result.size() < count) {
+			result.push_back(candidate);
+			std::push_heap(result.begin(), result.end(), CloserThan);
+		} else if (CloserThan(candidate, result.front())) {
+			std::pop_heap(result.begin(), result.end(), CloserThan);
+			result.back() = candidate;
+			std::push_heap(result.begin(), result.end(), CloserThan);
+		}
+	};
+	const PreparedCoordinates prepared_center = Prepare(center);
+	const int center_row = RowOf(center.lat);
+	const int center_col = ColOf(center.lng);
+	for (int ring = 0; ; ++ring) {
+		const double bound = RingDistanceBound(center, center_row, center_col, ring);
+		if (bound == std::numeric_limits<double>::infinity()
+			|| (result.size() == count && bound > result.front().distance)) {
+			break;
+		}
+		const int row_from = center_row - ring;
+		const int row_to = center_row + ring;
+		const int col_from = center_col - ring;
+		const int col_to = center_col + ring;
+		for (int row = std::max(row_from, 0); row <= std::min(row_to, rows_ - 1); ++row) {
+			if (row == row_from || row == row_to) {
+				for (int col = std::max(col_from, 0); col <= std::min(col_to, cols_ - 1); ++col) {
+					ForEachInCell(prepared_center, row, col, consider);
+				}
+			} else {
+				if (col_from >= 0) {
+					ForEachInCell(prepared_center, row, col_from, consider);
+				}
+				if (ring > 0 && col_to < cols_) {
+					ForEachInCell(prepared_center, row, col_to, consider);
+				}
+			}
+		}
+	}
+	std::sort_heap(result.begin(), result.end(), CloserThan);
+	return result;
+}
+
+int SpatialIndex::RowOf(double lat) const {
+	const double row = std::floor((lat - min_lat_) / cell_lat_);
+	return static_cast<int>(std::clamp(row, 0.0, static_cast<double>(rows_ - 1)));
+}
+
+int SpatialIndex::ColOf(double lng) const {
+	const double col = std::floor((lng - min_lng_) / cell_lng_);
+	return static_cast<int>(std::clamp(col, 0.0, static_cast<double>(cols_ - 1)));
+}
+
+double SpatialIndex::RingDistanceBound(Coordinates center, int row, int col, int ring) const {
+	const double infinity = std::numeric_limits<double>::infinity();
+	if (ring == 0) {
+		return 0.0;
+	}
+	const double lat_cos = std::cos(std::min(90.0, std::max(max_abs_lat_, std::abs(center.lat))) * DEGREE_TO_RADIAN);
+	const double lat_meters = DEGREE_TO_RADIAN * EARTH_RADIUS;
+	const double lng_meters = lat_meters * lat_cos;
+	// границы прямоугольника из уже просмотренных колец
+	const double south = min_lat_ + (row - ring + 1) * cell_lat_;
+	const double north = min_lat_ + (row + ring) * cell_lat_;
+	const double west = min_lng_ + (col - ring + 1) * cell_lng_;
+	const double east = min_lng_ + (col + ring) * cell_lng_;
+	// если center вне сетки, до любой её точки не ближе, чем до края сетки по второй оси
+	const double lat_outside = std::max({0.0, center.lat - max_lat_, min_lat_ - center.lat}) * lat_meters;
+	const double lng_outside = std::max({0.0, center.lng - max_lng_, min_lng_ - center.lng}) * lng_meters;
+	double bound = infinity;
+	if (row - ring >= 0) {
+		bound = std::min(bound, std::hypot(std::max(0.0, center.lat - south) * lat_meters, lng_outside));
+	}
+	if (row + ring < rows_) {
+		bound = std::min(bound, std::hypot(std::max(0.0, north - center.lat) * lat_meters, lng_outside));
+	}
+	if (col - ring >= 0) {
+		bound = std::min(bound, std::hypot(std::max(0.0, center.lng - west) * lng_meters, lat_outside));
+	}
+	if (col + ring < cols_) {
+		bound = std::min(bound, std::hypot(std::max(0.0, east - center.lng) * lng_meters, lat_outside));
+	}
+	return bound;
+}
+
+// BoxIndex ----------------------------------------------------------
+
+void BoxIndex::Build(const std::vector<Box>& boxes) {
+	boxes_ = boxes;
+	cell_offsets_.clear();
+	cell_items_.clear();
+	rows_ = cols_ = 0;
+	if (boxes.empty()) {
+		return;
+	}
+	Box bounds = boxes.front();
+	for (const Box& box : boxes) {
+		bounds.min_lat = std::min(bounds.min_lat, box.min_lat);
+		bounds.min_lng = std::min(bounds.min_lng, box.min_lng);
+		bounds.max_lat = std::max(bounds.max_lat, box.max_lat);
+		bounds.max_lng = std::max(bounds.max_lng, box.max_lng);
+	}
+	min_lat_ = bounds.min_lat;
+	min_lng_ = bounds.min_lng;
+	const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(boxes.size())))));
+	rows_ = cols_ = side;
+	const double lat_span = bounds.max_lat - min_lat_;
+	const double lng_span = bounds.max_lng - min_lng_;
+	cell_lat_ = lat_span > 0 ? lat_span / rows_ : 1.0;
+	cell_lng_ = lng_span > 0 ? lng_span / cols_ : 1.0;
+
+	// два прохода: число элементов в ячейках, затем раскладка по ячейкам
+	cell_offsets_.assign(static_cast<size_t>(rows_) * cols_ + 1, 0);
+	for (int pass = 0; pass < 2; ++pass) {
+		std::vector<uint32_t> fill_pos;
+		if (pass == 1) {
+			for (size_t i = 1; i < cell_offsets_.size(); ++i) {
+				cell_offsets_[i] += cell_offsets_[i - 1];
+			}
+			cell_items_.resize(cell_offsets_.back());
+			fill_pos.assign(cell_offsets_.begin(), cell_offsets_.end() - 1);
+		}
+		for (size_t i = 0; i < boxes.size(); ++i) {
+			const Box& box = boxes[i];
+			for (int row = RowOf(box.min_lat); row <= RowOf(box.max_lat); ++row) {
+				for (int col = ColOf(box.min_lng); col <= ColOf(box.max_lng); ++col) {
+					const size_t cell = static_cast<size_t>(row) * cols_ + col;
+					if (pass == 0) {
+						++cell_offsets_[cell + 1];
+					} else {
+						cell_items_[fill_pos[cell]++] = static_cast<uint32_t>(i);
+					}
+				}
+			}
+		}
+	}
+}
+
+std::vector<uint32_t> BoxIndex::Find(const Box& area) const {
+	std::vector<uint32_t> result;
+	if (Empty() || area.min_lat > area.max_lat || area.min_lng > area.max_lng) {
+		return result;
+	}
+	for (int row = RowOf(area.min_lat); row <= RowOf(area.max_lat); ++row) {
+		for (int col = ColOf(area.min_lng); col <= ColOf(area.max_lng); ++col) {
+			const size_t cell = static_cast<size_t>(row) * cols_ + col;
+			for (uint32_t pos = cell_offsets_[cell]; pos < cell_offsets_[cell + 1]; ++pos) {
+				if (boxes_[cell_items_[pos]].Intersects(area)) {
+					result.push_back(cell_items_[pos]);
+				}
+			}
+		}
+	}
+	// элемент из нескольких ячеек найден несколько раз
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+int BoxIndex::RowOf(double lat) const {
+	const double row = std::floor((lat - min_lat_) / cell_lat_);
+	return static_cast<int>(std::clamp(row, 0.0, static_cast<double>(rows_ - 1)));
+}
+
+int BoxIndex::ColOf(double lng) const {
+	const double col = std::floor((lng - min_lng_) / cell_lng_);
+	return static_cast<int>(std::clamp(col, 0.0, static_cast<double>(cols_ - 1)));
+}
+
+}// namespace geo
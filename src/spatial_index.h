@@ -0,0 +1,101 @@
+#pragma once
+
+#include "geo.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace geo {
+
+struct IndexedDistance {
+	uint32_t id;
+	double distance;
+};
+
+// Равномерная сетка по широте/долготе. Точки хранятся в порядке ячеек (CSR),
+// id точки - её позиция в векторе, переданном в Build.
+class SpatialIndex {
+public:
+	void Build(const std::vector<PreparedCoordinates>& points);
+
+	std::vector<IndexedDistance> FindInRadius(Coordinates center, double radius) const;
+	std::vector<IndexedDistance> FindNearest(Coordinates center, size_t count) const;
+
+	bool Empty() const { return cell_points_.empty(); }
+
+private:
+	int rows_ = 0;
+	int cols_ = 0;
+	double min_lat_ = 0;
+	double min_lng_ = 0;
+	double max_lat_ = 0;
+	double max_lng_ = 0;
+	double cell_lat_ = 1;
+	double cell_lng_ = 1;
+	double max_abs_lat_ = 0;
+	std::vector<uint32_t> cell_offsets_;
+	std::vector<uint32_t> cell_points_;
+	std::vector<PreparedCoordinates> cell_coordinates_;
+
+	int RowOf(double lat) const;
+	int ColOf(double lng) const;
+	// Оценка снизу расстояния от center до точек вне колец 0..ring-1 вокруг ячейки (row, col);
+	// бесконечность, если таких ячеек в сетке не осталось
+	double RingDistanceBound(Coordinates center, int row, int col, int ring) const;
+
+	// Передаёт в callback id каждой точки ячейки и расстояние до неё от center
+	template <typename Callback>
+	void ForEachInCell(const PreparedCoordinates& center, int row, int col, Callback callback) const {
+		const size_t cell = static_cast<size_t>(row) * cols_ + col;
+		constexpr uint32_t chunk = 64;
+		double distances[chunk];
+		for (uint32_t begin = cell_offsets_[cell]; begin < cell_offsets_[cell + 1]; begin += chunk) {
+			const uint32_t size = std::min(chunk, cell_offsets_[cell + 1] - begin);
+			ComputeDistances(center, cell_coordinates_.data() + begin, distances, size);
+			for (uint32_t i = 0; i < size; ++i) {
+				callback(cell_points_[begin + i], distances[i]);
+			}
+		}
+	}
+};
+
+// Прямоугольник в координатах: границы включаются
+struct Box {
+	double min_lat;
+	double min_lng;
+	double max_lat;
+	double max_lng;
+
+	bool Intersects(const Box& other) const {
+		return min_lat <= other.max_lat && other.min_lat <= max_lat && min_lng <= other.max_lng && other.min_lng <= max_lng;
+	}
+};
+
+// Равномерная сетка по широте/долготе для прямоугольников (точек и отрезков): элемент записан
+// во все ячейки, которые задевает его прямоугольник. id элемента - его позиция в векторе, переданном в Build.
+class BoxIndex {
+public:
+	void Build(const std::vector<Box>& boxes);
+
+	// id элементов, прямоугольники которых пересекают area, по возрастанию
+	std::vector<uint32_t> Find(const Box& area) const;
+
+	bool Empty() const { return boxes_.empty(); }
+
+private:
+	int rows_ = 0;
+	int cols_ = 0;
+	double min_lat_ = 0;
+	double min_lng_ = 0;
+	double cell_lat_ = 1;
+	double cell_lng_ = 1;
+	std::vector<Box> boxes_;
+	std::vector<uint32_t> cell_offsets_;
+	std::vector<uint32_t> cell_items_;
+
+	int RowOf(double lat) const;
+	int ColOf(double lng) const;
+};
+
+}// namespace geo
@@ -1,4 +1,7 @@
 #include "svg.h"
+#include "number_format.h"
+
+#include <sstream>
 
 using namespace std::literals;
 
@@ -78,28 +81,231 @@ std::ostream& operator<<(std::ostream& out, const svg::StrokeLineJoin &enum_clas
 	return out;
 }
 
-// Object ----------------------------------------------------------
+bool operator==(const Rgb& lhs, const Rgb& rhs) {
+	return lhs.red == rhs.red && lhs.green == rhs.green && lhs.blue == rhs.blue;
+}
+
+bool operator==(const Rgba& lhs, const Rgba& rhs) {
+	return lhs.red == rhs.red && lhs.green == rhs.green && lhs.blue == rhs.blue && lhs.opacity == rhs.opacity;
+}
+
+bool operator==(const Style& lhs, const Style& rhs) {
+	return lhs.fill_color == rhs.fill_color && lhs.stroke_color == rhs.stroke_color
+			&& lhs.line_cap == rhs.line_cap && lhs.line_join == rhs.line_join && lhs.stroke_width == rhs.stroke_width;
+}
+
+namespace {
+
+void RenderStyle(std::ostream& out, const Style& style) {
+	if (style.fill_color) {
+		out << " fill=\""sv << *style.fill_color << "\""sv;
+	}
+	if (style.stroke_color) {
+		out << " stroke=\""sv << *style.stroke_color << "\""sv;
+	}
+	if (style.stroke_width) {
+		out << " stroke-width=\""sv << *style.stroke_width << "\""sv;
+	}
+	if (style.line_cap) {
+		out << " stroke-linecap=\""sv << *style.line_cap << "\""sv;
+	}
+	if (style.line_join) {
+		out << " stroke-linejoin=\""sv << *style.line_join << "\""sv;
+	}
+}
+
+void RenderEscaped(std::string& out, std::string_view data) {
+	size_t begin = 0;
+	for (size_t i = 0; i < data.size(); ++i) {
+		std::string_view replacement;
+		switch (data[i]) {
+			case '"':
+				replacement = "&quot;"sv;
+				break;
+			case '\'':
+				replacement = "&apos;"sv;
+				break;
+			case '<':
+				replacement = "&lt;"sv;
+				break;
+			case '>':
+				replacement = "&gt;"sv;
+				break;
+			case '&':
+				replacement = "&amp;"sv;
+				break;
+			default:
+				continue;
+		}
+		out.append(data, begin, i - begin).append(replacement);
+		begin = i + 1;
+	}
+	out.append(data, begin);
+}
+
+void RenderNumber(std::string& out, double value) {
+	char buffer[format::NUMBER_SIZE];
+	out.append(buffer, format::WriteNumber(buffer, value));
+}
 
-void Document::AddPtr(std::unique_ptr<Object>&& obj) {
-	objects_.push_back(move(obj));
+void RenderNumber(std::string& out, uint32_t value) {
+	char buffer[format::NUMBER_SIZE];
+	out.append(buffer, format::WriteNumber(buffer, value));
 }
 
-void Object::Render(const RenderContext& context) const {
-	context.RenderIndent();
-	RenderObject(context);
-	context.out << std::endl;
+void RenderPoint(std::string& out, Point point, char separator) {
+	RenderNumber(out, point.x);
+	out += separator;
+	RenderNumber(out, point.y);
 }
 
+}// namespace
+
 // Document ----------------------------------------------------------
 
-void Document::Render(std::ostream& out) const  {
-	out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-	out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
-	RenderContext ctx(out, 2, 2);
-	for (auto& item_ptr : objects_) {
-		item_ptr->Render(ctx);
+uint32_t Document::AddStyle(const Style& style) {
+	// элементы одного слоя карты идут подряд, поэтому поиск начинается с последних записей
+	for (size_t i = styles_.size(); i > 0; --i) {
+		if (styles_[i - 1] == style) {
+			return static_cast<uint32_t>(i - 1);
+		}
+	}
+	styles_.push_back(style);
+	return static_cast<uint32_t>(styles_.size() - 1);
+}
+
+uint32_t Document::AddFont(uint32_t size, std::string_view family, std::string_view weight) {
+	for (size_t i = fonts_.size(); i > 0; --i) {
+		const Font& font = fonts_[i - 1];
+		if (font.size == size && font.family == family && font.weight == weight) {
+			return static_cast<uint32_t>(i - 1);
+		}
+	}
+	fonts_.push_back({size, std::string(family), std::string(weight)});
+	return static_cast<uint32_t>(fonts_.size() - 1);
+}
+
+void Document::AddCircle(Point center, double radius, uint32_t style) {
+	Element& element = elements_.emplace_back();
+	element.type = ElementType::CIRCLE;
+	element.style = style;
+	element.circle = {center, radius};
+}
+
+void Document::StartPolyline(uint32_t style) {
+	Element& element = elements_.emplace_back();
+	element.type = ElementType::POLYLINE;
+	element.style = style;
+	element.polyline = {static_cast<uint32_t>(points_.size()), 0};
+}
+
+void Document::AddPoint(Point point) {
+	points_.push_back(point);
+	++elements_.back().polyline.size;
+}
+
+void Document::AddText(Point position, Point offset, uint32_t font, std::string_view data, uint32_t style) {
+	Element& element = elements_.emplace_back();
+	element.type = ElementType::TEXT;
+	element.style = style;
+	element.text = {position, offset, font, static_cast<uint32_t>(text_.size()), static_cast<uint32_t>(data.size())};
+	text_ += data;
+}
+
+void Document::Add(const Circle& circle) {
+	AddCircle(circle.GetCenter(), circle.GetRadius(), AddStyle(circle.GetStyle()));
+}
+
+void Document::Add(const Polyline& polyline) {
+	StartPolyline(AddStyle(polyline.GetStyle()));
+	for (const Point& point : polyline.GetPoints()) {
+		AddPoint(point);
 	}
-	out << "</svg>"sv;
+}
+
+void Document::Add(const Text& text) {
+	AddText(text.GetPosition(), text.GetOffset(), AddFont(text.GetFontSize(), text.GetFontFamily(), text.GetFontWeight()),
+			text.GetData(), AddStyle(text.GetStyle()));
+}
+
+void Document::Render(std::string& out) const {
+	// атрибуты оформления выводятся в текст один раз
+	std::vector<std::string> styles;
+	styles.reserve(styles_.size());
+	for (const Style& style : styles_) {
+		std::ostringstream attrs;
+		RenderStyle(attrs, style);
+		styles.push_back(attrs.str());
+	}
+	out.reserve(out.size() + elements_.size() * 128 + points_.size() * 16 + text_.size());
+	out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+	out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+	for (const Element& element : elements_) {
+		const std::string& style = styles[element.style];
+		switch (element.type) {
+			case ElementType::CIRCLE: {
+				const CircleData& circle = element.circle;
+				out += "  <circle cx=\""sv;
+				RenderNumber(out, circle.center.x);
+				out += "\" cy=\""sv;
+				RenderNumber(out, circle.center.y);
+				out += "\" r=\""sv;
+				RenderNumber(out, circle.radius);
+				out += '"';
+				out += style;
+				out += "/>\n"sv;
+				break;
+			}
+			case ElementType::POLYLINE: {
+				const PolylineData& polyline = element.polyline;
+				out += "  <polyline points=\""sv;
+				for (uint32_t i = 0; i < polyline.size; ++i) {
+					if (i > 0) {
+						out += ' ';
+					}
+					RenderPoint(out, points_[polyline.begin + i], ',');
+				}
+				out += '"';
+				out += style;
+				out += "/> \n"sv;
+				break;
+			}
+			case ElementType::TEXT: {
+				const TextData& text = element.text;
+				const Font& font = fonts_[text.font];
+				out += "  <text"sv;
+				out += style;
+				out += " x=\""sv;
+				RenderNumber(out, text.position.x);
+				out += "\" y=\""sv;
+				RenderNumber(out, text.position.y);
+				out += "\" dx=\""sv;
+				RenderNumber(out, text.offset.x);
+				out += "\" dy=\""sv;
+				RenderNumber(out, text.offset.y);
+				out += "\" font-size=\""sv;
+				RenderNumber(out, font.size);
+				out += '"';
+				if (!font.family.empty()) {
+					out.append(" font-family=\""sv).append(font.family) += '"';
+				}
+				if (!font.weight.empty()) {
+					out.append(" font-weight=\""sv).append(font.weight) += '"';
+				}
+				out += '>';
+				RenderEscaped(out, std::string_view(text_).substr(text.begin, text.size));
+				out += "</text>\n"sv;
+				break;
+			}
+		}
+	}
+	out += "</svg>"sv;
+}
+
+void Document::Render(std::ostream& out) const {
+	std::string text;
+	Render(text);
+	out << text;
 }
 
 // Circle ----------------------------------------------------------
@@ -114,14 +320,6 @@ Circle& Circle::SetRadius(double radius)  {
 	return *this;
 }
 
-void Circle::RenderObject(const RenderContext& context) const {
-	auto& out = context.out;
-	out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-	out << "r=\""sv << radius_ << "\""sv;
-	RenderAttrs(out);
-	out << "/>"sv;
-}
-
 // Polyline ----------------------------------------------------------
 
 Polyline& Polyline::AddPoint(Point point) {
@@ -129,25 +327,6 @@ Polyline& Polyline::AddPoint(Point point) {
 	return *this;
 }
 
-void Polyline::RenderObject(const RenderContext& context) const {
-	auto& out = context.out;
-	//out << "  "sv;
-	out << "<polyline points=\""sv;
-	bool is_first = false;
-	for (auto& point : points_) {
-		if (is_first) {
-			out << " "sv;
-		}
-		is_first=true;
-		out << point.x << ","sv << point.y;
-
-	}
-	out << "\""sv;
-	RenderAttrs(out);
-	out << "/>"sv; //
-	out << ' '; //
-}
-
 // Text ----------------------------------------------------------
 
 Text& Text::SetPosition(Point pos) {
@@ -166,62 +345,20 @@ Text& Text::SetFontSize(uint32_t size) {
 }
 
 Text& Text::SetFontFamily(std::string font_family) {
-	font_family_ = font_family;
+	font_family_ = std::move(font_family);
 	return *this;
 }
 
 Text& Text::SetFontWeight(std::string font_weight) {
-	font_weight_ = font_weight;
+	font_weight_ = std::move(font_weight);
 	return *this;
 }
 
 Text& Text::SetData(std::string data) {
-	data_ = data;
+	data_ = std::move(data);
 	return *this;
 }
 
-void Text::RenderObject(const RenderContext& context) const  {
-	auto& out = context.out;
-	out << "<text"sv;
-	RenderAttrs(out);
-	out	<< " x=\""sv << position_.x << "\" y=\""sv << position_.y << "\" "sv
-		<< "dx=\""sv << offset_.x << "\" dy=\""sv << offset_.y << "\""sv
-		<< " font-size=\""sv << size_ << "\"" ;
-	if (!font_family_.empty()) {
-		out << " font-family=\""sv << font_family_ << "\""sv;
-	}
-	if (!font_weight_.empty()) {
-		out	<< " font-weight=\""sv << font_weight_ << "\""sv;
-	}
-	out	<< ">"sv;
-	if (!data_.empty()) {
-		for (auto& item : data_) {
-			if (item == '"') {
-				out << "&quot;"sv;
-				continue;
-			}
-			if (item == '\'') {
-				out << "&apos;"sv;
-				continue;
-			}
-			if (item == '<') {
-				out << "&lt;"sv;
-				continue;
-			}
-			if (item == '>') {
-				out << "&gt;"sv;
-				continue;
-			}
-			if (item == '&') {
-				out << "&amp;"sv;
-				continue;
-			}
-			out << item;
-		}
-	}
-	out << "</text>"sv;
-	}
-
 }// namespace svg
 
 namespace shapes {
@@ -4,9 +4,9 @@
 #include <cstdint>
 #include <cmath>
 #include <iostream>
-#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -66,52 +66,30 @@ struct Point {
 };
 
 
-struct RenderContext {
-	RenderContext(std::ostream& out)
-		: out(out) {
-	}
-
-	RenderContext(std::ostream& out, int indent_step, int indent = 0)
-		: out(out)
-		, indent_step(indent_step)
-		, indent(indent) {
-	}
+class Circle;
+class Polyline;
+class Text;
 
-	RenderContext Indented() const {
-		return {out, indent_step, indent + indent_step};
-	}
-
-	void RenderIndent() const {
-		for (int i = 0; i < indent; ++i) {
-			out.put(' ');
-		}
-	}
-
-	std::ostream& out;
-	int indent_step = 0;
-	int indent = 0;
+// Оформление элемента: атрибуты fill, stroke, stroke-width, stroke-linecap и stroke-linejoin
+struct Style {
+	std::optional<Color> fill_color;
+	std::optional<Color> stroke_color;
+	std::optional<StrokeLineCap> line_cap;
+	std::optional<StrokeLineJoin> line_join;
+	std::optional<double> stroke_width;
 };
 
-class Object {
-public:
-	virtual ~Object() = default;
-	void Render(const RenderContext& context) const;
-
-
-private:
-	virtual void RenderObject(const RenderContext& context) const = 0;
-};
+bool operator==(const Rgb& lhs, const Rgb& rhs);
+bool operator==(const Rgba& lhs, const Rgba& rhs);
+bool operator==(const Style& lhs, const Style& rhs);
 
 class ObjectContainer {
 public:
 	virtual ~ObjectContainer() = default;
 
-	template <typename Obj>
-	void Add(Obj obj) {
-		AddPtr(std::make_unique<Obj>(std::move(obj)));
-	}
-
-	virtual void AddPtr(std::unique_ptr<Object>&& obj) = 0;
+	virtual void Add(const Circle& circle) = 0;
+	virtual void Add(const Polyline& polyline) = 0;
+	virtual void Add(const Text& text) = 0;
 };
 
 class Drawable  {
@@ -120,14 +98,77 @@ public:
 	virtual void Draw(ObjectContainer& ) const = 0;
 };
 
-class Document : public ObjectContainer {
+// Документ хранит элементы в одном массиве без выделения памяти на каждый. Оформление и шрифты
+// записываются один раз и разделяются элементами по номеру, точки ломаных и тексты лежат
+// в общих массивах документа.
+class Document final : public ObjectContainer {
 public:
-	virtual ~Document() = default;
-	void AddPtr(std::unique_ptr<Object>&& obj) override;
+	// Номер оформления для элементов; одинаковое оформление хранится один раз
+	uint32_t AddStyle(const Style& style);
+	uint32_t AddFont(uint32_t size, std::string_view family, std::string_view weight);
+
+	void AddCircle(Point center, double radius, uint32_t style);
+	// Точки AddPoint добавляются к последней начатой ломаной
+	void StartPolyline(uint32_t style);
+	void AddPoint(Point point);
+	void AddText(Point position, Point offset, uint32_t font, std::string_view data, uint32_t style);
+
+	void Add(const Circle& circle) override;
+	void Add(const Polyline& polyline) override;
+	void Add(const Text& text) override;
+
+	// Дописывает текст документа в конец out
+	void Render(std::string& out) const;
 	void Render(std::ostream& out) const;
 
 private:
-	std::vector<std::unique_ptr<Object>>  objects_;
+	enum class ElementType : uint8_t {
+		CIRCLE, POLYLINE, TEXT,
+	};
+
+	struct CircleData {
+		Point center;
+		double radius;
+	};
+	// точки points_[begin, begin + size)
+	struct PolylineData {
+		uint32_t begin;
+		uint32_t size;
+	};
+	// текст text_[begin, begin + size)
+	struct TextData {
+		Point position;
+		Point offset;
+		uint32_t font;
+		uint32_t begin;
+		uint32_t size;
+	};
+
+	struct Element {
+		Element()
+			: circle() {
+		}
+
+		ElementType type = ElementType::CIRCLE;
+		uint32_t style = 0;
+		union {
+			CircleData circle;
+			PolylineData polyline;
+			TextData text;
+		};
+	};
+
+	struct Font {
+		uint32_t size;
+		std::string family;
+		std::string weight;
+	};
+
+	std::vector<Element> elements_;
+	std::vector<Style> styles_;
+	std::vector<Font> fonts_;
+	std::vector<Point> points_;
+	std::string text_;
 };
 
 //-----------------------------------------------------------------
@@ -141,92 +182,82 @@ std::ostream& operator<<(std::ostream& out, const svg::Rgb& roots);
 
 //-----------------------------------------------------------------
 
+// Описание элемента для ObjectContainer: документ копирует его в свои массивы
 template <typename Owner>
 class PathProps {
 public:
 	Owner& SetFillColor(Color color) {
-		fill_color_ = std::move(color);
+		style_.fill_color = std::move(color);
 		return AsOwner();
 	}
 
 	Owner& SetStrokeColor(Color color) {
-		stroke_color_ = std::move(color);
+		style_.stroke_color = std::move(color);
 		return AsOwner();
 	}
 
 	Owner& SetStrokeLineCap(StrokeLineCap type) {
-		fill_linecap_ = std::move(type);
+		style_.line_cap = type;
 		return AsOwner();
 	}
 
 	Owner& SetStrokeLineJoin(StrokeLineJoin type) {
-		stroke_linejoin_ = std::move(type);
+		style_.line_join = type;
 		return AsOwner();
 	}
 
 	Owner& SetStrokeWidth(double num) {
-		stroke_width_ = num;
+		style_.stroke_width = num;
 		return AsOwner();
 	}
 
+	const Style& GetStyle() const {
+		return style_;
+	}
+
 protected:
 	~PathProps() = default;
 
-	void RenderAttrs(std::ostream& out) const {
-		using namespace std::literals;
-		if (fill_color_) {
-			out << " fill=\""sv << *fill_color_ << "\""sv;
-		}
-		if (stroke_color_) {
-			out << " stroke=\""sv << *stroke_color_ << "\""sv; //
-		}
-		if (stroke_width_) {
-			out << " stroke-width=\""sv << *stroke_width_ << "\""sv; //
-		}
-		if (fill_linecap_) {
-			out << " stroke-linecap=\""sv << *fill_linecap_ << "\""sv; //
-		}
-		if (stroke_linejoin_) {
-			out << " stroke-linejoin=\""sv << *stroke_linejoin_ << "\""sv; //
-		}
-	}
-
 private:
 	Owner& AsOwner() {
 		return static_cast<Owner&>(*this);
 	}
 
-	std::optional<Color> fill_color_;
-	std::optional<Color> stroke_color_;
-	std::optional<StrokeLineCap> fill_linecap_;
-	std::optional<StrokeLineJoin> stroke_linejoin_;
-	std::optional<double> stroke_width_;
+	Style style_;
 };
 
 //-----------------------------------------------------------------
 
-class Circle final : public Object, public PathProps<Circle> {
+class Circle final : public PathProps<Circle> {
 public:
 	Circle& SetCenter(Point center);
 	Circle& SetRadius(double radius);
 
+	Point GetCenter() const {
+		return center_;
+	}
+	double GetRadius() const {
+		return radius_;
+	}
+
 private:
-	void RenderObject(const RenderContext& context) const override;
 	Point center_;
 	double radius_ = 1.0;
 };
 
-class Polyline : public Object, public PathProps<Polyline> {
+class Polyline final : public PathProps<Polyline> {
 public:
 	Polyline& AddPoint(Point point);
 
-private:
-	void RenderObject(const RenderContext& context) const override;
+	const std::vector<Point>& GetPoints() const {
+		return points_;
+	}
 
+private:
 	std::vector<Point> points_;
 };
 
-class Text : public Object, public PathProps<Text> {
+class Text final : public PathProps<Text> {
 public:
 	Text& SetPosition(Point pos);
 	Text& SetOffset(Point offset);
@@ -235,9 +266,26 @@ public:
 	Text& SetFontWeight(std::string font_weight);
 	Text& SetData(std::string data);
 
-private:
-	void RenderObject(const RenderContext& context) const override;
+	Point GetPosition() const {
+		return position_;
+	}
+	Point GetOffset() const {
+		return offset_;
+	}
+	uint32_t GetFontSize() const {
+		return size_;
+	}
+	const std::string& GetFontFamily() const {
+		return font_family_;
+	}
+	const std::string& GetFontWeight() const {
+		return font_weight_;
+	}
+	const std::string& GetData() const {
+		return data_;
+	}
 
+private:
 	Point position_ = {0.0, 0.0};
 	Point offset_ = {0.0, 0.0};
 	uint32_t size_ = 1;
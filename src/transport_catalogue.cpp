@@ -1,12 +1,44 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
 namespace location {
 
 using namespace detail;
 using namespace geo;
 
+namespace {
+
+// Делит [0, count) на участки по числу ядер и обрабатывает их параллельно, небольшой объём
+// обрабатывается в текущем потоке. Исключение из любого участка передаётся вызывающему.
+template <typename Func>
+void ParallelFor(size_t count, Func func) {
+	constexpr size_t min_chunk = 4096;
+	const size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), (count + min_chunk - 1) / min_chunk);
+	if (threads <= 1) {
+		func(size_t{0}, count);
+		return;
+	}
+	const size_t chunk = (count + threads - 1) / threads;
+	std::vector<std::future<void>> tasks;
+	for (size_t begin = chunk; begin < count; begin += chunk) {
+		tasks.push_back(std::async(std::launch::async, func, begin, std::min(count, begin + chunk)));
+	}
+	func(size_t{0}, chunk);
+	for (std::future<void>& task : tasks) {
+		task.get();
+	}
+}
+
+}// namespace
+
 size_t StopsPairHasher::operator()(const std::pair<const Stop*, const Stop*>& target_pair) const {
-	return hasher_(std::get<0>(target_pair)) + hasher_(std::get<1>(target_pair));
+	return hasher_(std::get<0>(target_pair)) + hasher_(std::get<1>(target_pair)) * 37;
 }
 
 void TransportCatalogue::AddDistances(std::map<std::string_view, std::vector<std::pair<std::string_view, int>>>& raw_data) {
@@ -14,7 +46,7 @@ void TransportCatalogue::AddDistances(std::map<std::string_view, std::vector<std
 		const Stop* countdown_ptr(FindStop(countdown_name));
 		for (auto& [destination_name, distance] : distances_vector) {
 			const Stop* destination_ptr(FindStop(destination_name));
-			stops_distances_.insert({{countdown_ptr, destination_ptr}, distance});
+			stops_distances_.insert_or_assign({countdown_ptr, destination_ptr}, distance);
 		}
 	}
 }
@@ -25,45 +57,312 @@ void TransportCatalogue::AddRoute(std::string_view route_number, bool route_type
 	for (auto item : stops_list) {
 		const Stop* current_ptr = FindStop(item);
 		route_result.push_back(current_ptr);
-		available_routes_[current_ptr].insert(route_number_str);
 	}
-	buses_.push_back({move(route_number_str), route_type, route_result});
+	uint32_t id = static_cast<uint32_t>(buses_.size());
+	buses_.push_back({move(route_number_str), route_type, route_result, id});
 	buses_auxiliary_map_.insert({buses_.back().route_number, &buses_.back()});
 }
 
+void TransportCatalogue::BulkLoad(const BulkData& data) {
+	if (!stops_.empty() || !buses_.empty()) {
+		throw std::logic_error("BulkLoad requires an empty catalogue");
+	}
+	stops_auxiliary_map_.reserve(data.stops.size());
+	for (const BulkData::StopRecord& record : data.stops) {
+		const uint32_t id = static_cast<uint32_t>(stops_.size());
+		stops_.push_back({std::string(record.name), record.coordinates, id});
+		stops_auxiliary_map_.emplace(stops_.back().name, &stops_.back());
+	}
+	stops_coordinates_.resize(data.stops.size());
+	ParallelFor(data.stops.size(), [this, &data](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			stops_coordinates_[i] = Prepare(data.stops[i].coordinates);
+		}
+	});
+
+	auto resolve = [this](std::string_view name) {
+		const Stop* stop = FindStop(name);
+		if (!stop) {
+			throw std::invalid_argument("Unknown stop " + std::string(name));
+		}
+		return stop;
+	};
+	buses_auxiliary_map_.reserve(data.routes.size());
+	for (const BulkData::RouteRecord& record : data.routes) {
+		const uint32_t id = static_cast<uint32_t>(buses_.size());
+		buses_.push_back({std::string(record.route_number), record.is_circular, {}, id});
+		buses_auxiliary_map_.emplace(buses_.back().route_number, &buses_.back());
+	}
+	ParallelFor(data.routes.size(), [this, &data, &resolve](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const BulkData::RouteRecord& record = data.routes[i];
+			std::vector<const Stop*>& route_stops = buses_[i].route_stops;
+			route_stops.reserve(record.stops_end - record.stops_begin);
+			for (uint32_t stop = record.stops_begin; stop < record.stops_end; ++stop) {
+				route_stops.push_back(resolve(data.route_stops[stop]));
+			}
+		}
+	});
+
+	std::vector<std::pair<const Stop*, const Stop*>> distance_stops(data.distances.size());
+	ParallelFor(data.distances.size(), [this, &data, &resolve, &distance_stops](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			distance_stops[i] = {&stops_.at(data.distances[i].from), resolve(data.distances[i].to)};
+		}
+	});
+	stops_distances_.reserve(data.distances.size());
+	for (size_t i = 0; i < distance_stops.size(); ++i) {
+		stops_distances_.emplace(distance_stops[i], data.distances[i].distance);
+	}
+
+	// производные структуры не зависят друг от друга и пишут в разные поля
+	std::future<void> spatial_index = std::async(std::launch::async, [this] {
+		BuildSpatialIndex();
+	});
+	std::future<void> names_index = std::async(std::launch::async, [this] {
+		BuildNamesIndex();
+	});
+	BuildStopsIndex();
+	BuildRoutesDistances();
+	spatial_index.get();
+	names_index.get();
+}
+
 void TransportCatalogue::AddStop(std::string_view name, Coordinates coordinates) {
 	std::string name_str(name.begin(), name.end());
-	stops_.push_back({move(name_str), coordinates});
-	available_routes_.insert({&stops_.back(), {} });
+	uint32_t id = static_cast<uint32_t>(stops_.size());
+	stops_.push_back({move(name_str), coordinates, id});
+	stops_coordinates_.push_back(Prepare(coordinates));
 	stops_auxiliary_map_.insert({stops_.back().name, &stops_.back()});
 }
 
+void TransportCatalogue::UpdateStop(std::string_view name, Coordinates coordinates) {
+	const Stop* found = FindStop(name);
+	if (!found) {
+		AddStop(name, coordinates);
+		return;
+	}
+	stops_[found->id].coordinates = coordinates;
+	stops_coordinates_[found->id] = Prepare(coordinates);
+}
+
+void TransportCatalogue::UpdateRoute(std::string_view route_number, bool route_type, std::vector<std::string_view> stops_list) {
+	std::vector<const Stop*> route_result;
+	route_result.reserve(stops_list.size());
+	for (auto item : stops_list) {
+		const Stop* current_ptr = FindStop(item);
+		if (!current_ptr) {
+			throw std::invalid_argument("Unknown stop " + std::string(item) + " in bus " + std::string(route_number));
+		}
+		route_result.push_back(current_ptr);
+	}
+	const Bus* found = FindRoute(route_number);
+	if (!found) {
+		AddRoute(route_number, route_type, move(stops_list));
+		return;
+	}
+	Bus& bus = buses_[found->id];
+	bus.is_circular = route_type;
+	bus.route_stops = move(route_result);
+}
+
+void TransportCatalogue::RemoveStop(std::string_view name) {
+	const Stop* removed = FindStop(name);
+	if (!removed) {
+		throw std::invalid_argument("Unknown stop " + std::string(name));
+	}
+	for (const Bus& bus : buses_) {
+		if (std::find(bus.route_stops.begin(), bus.route_stops.end(), removed) != bus.route_stops.end()) {
+			throw std::invalid_argument("Stop " + std::string(name) + " is used by bus " + bus.route_number);
+		}
+	}
+	const uint32_t removed_id = removed->id;
+	auto shifted = [removed_id](uint32_t id) {
+		return id > removed_id ? id - 1 : id;
+	};
+	// после erase элементы deque сдвигаются, поэтому все ссылки на остановки переводятся в id заранее
+	std::vector<std::vector<uint32_t>> routes_ids;
+	routes_ids.reserve(buses_.size());
+	for (const Bus& bus : buses_) {
+		std::vector<uint32_t> ids;
+		ids.reserve(bus.route_stops.size());
+		for (const Stop* stop : bus.route_stops) {
+			ids.push_back(shifted(stop->id));
+		}
+		routes_ids.push_back(move(ids));
+	}
+	std::vector<std::tuple<uint32_t, uint32_t, int>> distances;
+	distances.reserve(stops_distances_.size());
+	for (const auto& [stops_pair, distance] : stops_distances_) {
+		if (stops_pair.first != removed && stops_pair.second != removed) {
+			distances.emplace_back(shifted(stops_pair.first->id), shifted(stops_pair.second->id), distance);
+		}
+	}
+
+	stops_.erase(stops_.begin() + removed_id);
+	stops_coordinates_.erase(stops_coordinates_.begin() + removed_id);
+	stops_auxiliary_map_.clear();
+	for (uint32_t id = 0; id < stops_.size(); ++id) {
+		stops_[id].id = id;
+		stops_auxiliary_map_.insert({stops_[id].name, &stops_[id]});
+	}
+	for (size_t i = 0; i < buses_.size(); ++i) {
+		for (size_t j = 0; j < routes_ids[i].size(); ++j) {
+			buses_[i].route_stops[j] = &stops_[routes_ids[i][j]];
+		}
+	}
+	stops_distances_.clear();
+	for (const auto& [from, to, distance] : distances) {
+		stops_distances_.insert({{&stops_[from], &stops_[to]}, distance});
+	}
+}
+
+void TransportCatalogue::RemoveRoute(std::string_view route_number) {
+	const Bus* removed = FindRoute(route_number);
+	if (!removed) {
+		throw std::invalid_argument("Unknown bus " + std::string(route_number));
+	}
+	buses_.erase(buses_.begin() + removed->id);
+	buses_auxiliary_map_.clear();
+	for (uint32_t id = 0; id < buses_.size(); ++id) {
+		buses_[id].id = id;
+		buses_auxiliary_map_.insert({buses_[id].route_number, &buses_[id]});
+	}
+}
+
+void TransportCatalogue::RemoveDistance(std::string_view from, std::string_view to) {
+	const Stop* ptr_from = FindStop(from);
+	const Stop* ptr_to = FindStop(to);
+	if (!ptr_from || !ptr_to) {
+		throw std::invalid_argument("Unknown stop in distance " + std::string(from) + " - " + std::string(to));
+	}
+	stops_distances_.erase({ptr_from, ptr_to});
+}
+
 int TransportCatalogue::GetDistance(const Stop* ptr_from, const Stop* ptr_to) const {
-	int result = 0;
-		if (stops_distances_.find({ptr_from, ptr_to}) != stops_distances_.end()) {
-			result = stops_distances_.at({ptr_from, ptr_to});
-		} else {
-			result = stops_distances_.at({ptr_to, ptr_from});
+	if (auto iter = stops_distances_.find({ptr_from, ptr_to}); iter != stops_distances_.end()) {
+		return iter->second;
+	}
+	return stops_distances_.at({ptr_to, ptr_from});
+}
+
+const Bus* TransportCatalogue::FindRoute(std::string_view request_number) const {
+	auto iter = buses_auxiliary_map_.find(request_number);
+	return iter != buses_auxiliary_map_.end() ? iter->second : nullptr;
+}
+
+const Stop* TransportCatalogue::FindStop(std::string_view stop_name) const {
+	auto iter = stops_auxiliary_map_.find(stop_name);
+	return iter != stops_auxiliary_map_.end() ? iter->second : nullptr;
+}
+
+TransportCatalogue::BusIdsRange TransportCatalogue::FindAvailableRoutes(std::string_view stop_name) const {
+	const Stop* stop = FindStop(stop_name);
+	if (!stop || stop->id + 1 >= stop_buses_offsets_.size()) {
+		return {stop_buses_.end(), stop_buses_.end()};
+	}
+	return {stop_buses_.begin() + stop_buses_offsets_[stop->id], stop_buses_.begin() + stop_buses_offsets_[stop->id + 1]};
+}
+
+void TransportCatalogue::BuildStopsIndex() {
+	std::vector<uint32_t> buses_order(buses_.size());
+	for (uint32_t i = 0; i < buses_order.size(); ++i) {
+		buses_order[i] = i;
+	}
+	std::sort(buses_order.begin(), buses_order.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return buses_[lhs].route_number < buses_[rhs].route_number;
+	});
+	// last_bus не даёт посчитать автобус дважды, если остановка повторяется в маршруте
+	const uint32_t none = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> last_bus(stops_.size(), none);
+	stop_buses_offsets_.assign(stops_.size() + 1, 0);
+	for (uint32_t bus_id : buses_order) {
+		for (const Stop* stop : buses_[bus_id].route_stops) {
+			if (last_bus[stop->id] != bus_id) {
+				last_bus[stop->id] = bus_id;
+				++stop_buses_offsets_[stop->id + 1];
+			}
 		}
+	}
+	for (size_t i = 1; i < stop_buses_offsets_.size(); ++i) {
+		stop_buses_offsets_[i] += stop_buses_offsets_[i - 1];
+	}
+	stop_buses_.assign(stop_buses_offsets_.back(), 0);
+	std::vector<uint32_t> fill_pos(stop_buses_offsets_.begin(), stop_buses_offsets_.end() - 1);
+	last_bus.assign(stops_.size(), none);
+	for (uint32_t bus_id : buses_order) {
+		for (const Stop* stop : buses_[bus_id].route_stops) {
+			if (last_bus[stop->id] != bus_id) {
+				last_bus[stop->id] = bus_id;
+				stop_buses_[fill_pos[stop->id]++] = bus_id;
+			}
+		}
+	}
+}
+
+void TransportCatalogue::BuildRoutesDistances() {
+	// last_bus отмечает остановки, уже посчитанные для текущего маршрута
+	std::vector<uint32_t> last_bus(stops_.size(), std::numeric_limits<uint32_t>::max());
+	for (Bus& bus : buses_) {
+		bus.unique_stops = 0;
+		for (const Stop* stop : bus.route_stops) {
+			if (last_bus[stop->id] != bus.id) {
+				last_bus[stop->id] = bus.id;
+				++bus.unique_stops;
+			}
+		}
+		const size_t segments = bus.route_stops.empty() ? 0 : bus.route_stops.size() - 1;
+		bus.forward_distances.resize(segments);
+		bus.backward_distances.resize(segments);
+		bus.forward_prefix.assign(bus.route_stops.size(), 0);
+		bus.backward_prefix.assign(bus.route_stops.size(), 0);
+		for (size_t i = 0; i < segments; ++i) {
+			bus.forward_distances[i] = GetDistance(bus.route_stops[i], bus.route_stops[i + 1]);
+			bus.backward_distances[i] = GetDistance(bus.route_stops[i + 1], bus.route_stops[i]);
+			bus.forward_prefix[i + 1] = bus.forward_prefix[i] + bus.forward_distances[i];
+			bus.backward_prefix[i + 1] = bus.backward_prefix[i] + bus.backward_distances[i];
+		}
+	}
+}
+
+void TransportCatalogue::BuildSpatialIndex() {
+	stops_index_.Build(stops_coordinates_);
+}
+
+std::vector<NearbyStop> TransportCatalogue::FindStopsInRadius(Coordinates center, double radius) const {
+	std::vector<NearbyStop> result;
+	for (const geo::IndexedDistance& found : stops_index_.FindInRadius(center, radius)) {
+		result.push_back({&stops_[found.id], found.distance});
+	}
 	return result;
 }
 
-const Bus* TransportCatalogue::FindRoute(std::string_view request_number) {
-	return buses_auxiliary_map_.count(request_number) ? buses_auxiliary_map_.at(request_number) : nullptr;
+std::vector<NearbyStop> TransportCatalogue::FindNearestStops(Coordinates center, size_t count) const {
+	std::vector<NearbyStop> result;
+	for (const geo::IndexedDistance& found : stops_index_.FindNearest(center, count)) {
+		result.push_back({&stops_[found.id], found.distance});
+	}
+	return result;
 }
 
-const Stop* TransportCatalogue::FindStop(std::string_view stop_name) {
-	return stops_auxiliary_map_.count(stop_name) ? stops_auxiliary_map_.at(stop_name) : nullptr;
+void TransportCatalogue::BuildNamesIndex() {
+	std::vector<std::string_view> names;
+	names.reserve(stops_.size());
+	for (const Stop& stop : stops_) {
+		names.push_back(stop.name);
+	}
+	stops_names_index_.Build(names);
 }
 
-std::set<std::string>* TransportCatalogue::FindAvailableRoutes(std::string_view stop_name) {
-	if (available_routes_.count(FindStop(stop_name))) {
-		return &available_routes_.at(FindStop(stop_name));
+std::vector<const Stop*> TransportCatalogue::FindStopsByPrefix(std::string_view prefix, size_t count, bool fuzzy) const {
+	std::vector<const Stop*> result;
+	for (uint32_t id : stops_names_index_.FindByPrefix(prefix, count, fuzzy)) {
+		result.push_back(&stops_[id]);
 	}
-	return nullptr;
+	return result;
 }
 
-RouteData TransportCatalogue::GetRouteInformation(std::string_view request_number) {
+RouteData TransportCatalogue::GetRouteInformation(std::string_view request_number) const {
 	const Bus* selected_bus(FindRoute(request_number));
 	double path_length_temp = 0.0;
 	if (selected_bus) {
@@ -71,32 +370,22 @@ RouteData TransportCatalogue::GetRouteInformation(std::string_view request_numbe
 		int unique_stops = 0;
 		double curvature = 0;
 		double straight_distance = 0;
-		Coordinates* previous_position = nullptr;
-		const Stop* temp_stop_ptr = nullptr;
+		const PreparedCoordinates* previous_position = nullptr;
 		for (const auto Stop : selected_bus->route_stops) {
 			if (previous_position) {
-				straight_distance += ComputeDistance(*previous_position, Stop->coordinates);
-			}
-		previous_position = const_cast<Coordinates*>(&Stop->coordinates);
-			if (temp_stop_ptr) {
-				path_length_temp += GetDistance(temp_stop_ptr, Stop);
+				straight_distance += ComputeDistance(*previous_position, stops_coordinates_[Stop->id]);
 			}
-			temp_stop_ptr = Stop;
+			previous_position = &stops_coordinates_[Stop->id];
 		}
-		std::set<const Stop*> temp_stops_ptr;
-		for (auto item : selected_bus->route_stops) {
-			temp_stops_ptr.insert(item);
+		if (!selected_bus->forward_prefix.empty()) {
+			path_length_temp += selected_bus->forward_prefix.back();
 		}
-		unique_stops = temp_stops_ptr.size();
+		unique_stops = selected_bus->unique_stops;
 		if (!selected_bus->is_circular) {
 			stops_on_route = (selected_bus->route_stops.size() * 2) - 1;
 			straight_distance *= 2;
-			temp_stop_ptr = nullptr;
-			for (auto iter = selected_bus->route_stops.rbegin(); iter != selected_bus->route_stops.rend(); ++iter) {
-				if (temp_stop_ptr) {
-					path_length_temp += GetDistance(temp_stop_ptr, *iter);
-				}
-				temp_stop_ptr = *iter;
+			if (!selected_bus->backward_prefix.empty()) {
+				path_length_temp += selected_bus->backward_prefix.back();
 			}
 			curvature = path_length_temp / straight_distance;
 		} else {
@@ -109,15 +398,32 @@ RouteData TransportCatalogue::GetRouteInformation(std::string_view request_numbe
 	}
 }
 
-void TransportCatalogue::AddDeserializedStop(location::Stop& stop, std::set<std::string>& aviable_routes) {
+void TransportCatalogue::AddDeserializedStop(location::Stop& stop) {
+	stop.id = static_cast<uint32_t>(stops_.size());
 	stops_.push_back(std::move(stop));
-	if (!aviable_routes.empty()) {
-		available_routes_.insert({&stops_.back(), std::move(aviable_routes)});
-	}
+	stops_coordinates_.push_back(Prepare(stops_.back().coordinates));
 	stops_auxiliary_map_.insert({stops_.back().name,  &stops_.back()});
 }
 
+void TransportCatalogue::AddDeserializedStopsIndex(std::vector<uint32_t> offsets, std::vector<uint32_t> bus_ids) {
+	if (offsets.size() != stops_.size() + 1 || offsets.back() != bus_ids.size()) {
+		BuildStopsIndex();
+		return;
+	}
+	stop_buses_offsets_ = std::move(offsets);
+	stop_buses_ = std::move(bus_ids);
+}
+
+void TransportCatalogue::AddDeserializedNamesIndex(NameIndex names_index) {
+	if (names_index.GetIds().size() != stops_.size()) {
+		BuildNamesIndex();
+		return;
+	}
+	stops_names_index_ = std::move(names_index);
+}
+
 void TransportCatalogue::AddDeserializedBus(location::Bus& bus) {
+	bus.id = static_cast<uint32_t>(buses_.size());
 	buses_.push_back(std::move(bus));
 	buses_auxiliary_map_.insert({buses_.back().route_number, &buses_.back()});
 
@@ -128,4 +434,8 @@ void TransportCatalogue::AddDeserializedDistance(const Stop* from, const Stop* t
 }
 
 
+CatalogueSnapshot MakeSnapshot(TransportCatalogue&& transport_catalog) {
+	return std::make_shared<const TransportCatalogue>(std::move(transport_catalog));
+}
+
 }// namespace location
@@ -3,12 +3,15 @@
 #include <deque>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
-#include <set>
 #include <tuple>
 #include <unordered_map>
 
 #include "domain.h"
+#include "name_index.h"
+#include "ranges.h"
+#include "spatial_index.h"
 
 namespace location {
 namespace detail {
@@ -22,36 +25,135 @@ private:
 
 }// namespace detail
 
+// Сырые записи базы для TransportCatalogue::BulkLoad. Строки ссылаются на разобранный документ,
+// остановки маршрута лежат в route_stops на участке [stops_begin, stops_end),
+// from у расстояния - номер записи остановки в stops.
+struct BulkData {
+	struct StopRecord {
+		std::string_view name;
+		geo::Coordinates coordinates;
+	};
+	struct RouteRecord {
+		std::string_view route_number;
+		bool is_circular;
+		uint32_t stops_begin;
+		uint32_t stops_end;
+	};
+	struct DistanceRecord {
+		uint32_t from;
+		std::string_view to;
+		int distance;
+	};
+
+	std::vector<StopRecord> stops;
+	std::vector<RouteRecord> routes;
+	std::vector<std::string_view> route_stops;
+	std::vector<DistanceRecord> distances;
+	// названия, которых нет в тексте исходного документа дословно (были escape-последовательности)
+	std::deque<std::string> strings;
+};
+
 class TransportCatalogue {
 public:
+	using BusIdsRange = ranges::Range<std::vector<uint32_t>::const_iterator>;
+
+	TransportCatalogue() = default;
+	// остановки и маршруты ссылаются друг на друга по указателям: копия была бы некорректной,
+	// а перемещение deque сохраняет адреса элементов
+	TransportCatalogue(const TransportCatalogue&) = delete;
+	TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+	TransportCatalogue(TransportCatalogue&&) = default;
+	TransportCatalogue& operator=(TransportCatalogue&&) = default;
+
 	void AddDistances(std::map<std::string_view, std::vector<std::pair<std::string_view, int>>>& raw_data);
 	void AddStop(std::string_view name, geo::Coordinates coordinates);
 	void AddRoute(std::string_view route_number, bool route_type, std::vector<std::string_view> stops_list);
+	// Загрузка всей базы в пустой каталог: контейнеры резервируются под точное число записей,
+	// названия разрешаются и производные структуры строятся параллельно. Из записей с одинаковым
+	// названием или парой остановок поиск видит первую, неизвестная остановка - исключение.
+	void BulkLoad(const BulkData& data);
 
 	int GetDistance(const Stop* ptr_from, const Stop* ptr_to) const;
 	const std::deque<Bus>& GetRoutes() const { return buses_; }
 	const std::deque<Stop>& GetStops() const { return stops_; }
- 	std::unordered_map<std::pair<const Stop*, const Stop*>, int, location::detail::StopsPairHasher>* GetDistances() {
- 		return &stops_distances_;
- 	}
+	const std::unordered_map<std::pair<const Stop*, const Stop*>, int, location::detail::StopsPairHasher>* GetDistances() const {
+		return &stops_distances_;
+	}
+
+	const Bus* FindRoute(std::string_view request_number) const;
+	const Stop* FindStop(std::string_view stop_name) const;
+	BusIdsRange FindAvailableRoutes(std::string_view stop_name) const;
+
+	// Раскладывает маршруты по остановкам: для каждой остановки непрерывный участок
+	// stop_buses_ с id автобусов, упорядоченных по названию. Вызывается после добавления всех маршрутов.
+	void BuildStopsIndex();
+	const std::vector<uint32_t>& GetStopBusesOffsets() const { return stop_buses_offsets_; }
+	const std::vector<uint32_t>& GetStopBuses() const { return stop_buses_; }
+
+	// Заполняет у каждого маршрута массивы длин перегонов, префиксных сумм и число уникальных остановок.
+	// Вызывается после добавления расстояний.
+	void BuildRoutesDistances();
+
+	// Изменение загруженного каталога. После них производные структуры (BuildStopsIndex,
+	// BuildRoutesDistances, BuildSpatialIndex, BuildNamesIndex) нужно построить заново.
+	// Update* добавляют объект или заменяют существующий с тем же именем.
+	void UpdateStop(std::string_view name, geo::Coordinates coordinates);
+	void UpdateRoute(std::string_view route_number, bool route_type, std::vector<std::string_view> stops_list);
+	void RemoveStop(std::string_view name);
+	void RemoveRoute(std::string_view route_number);
+	void RemoveDistance(std::string_view from, std::string_view to);
 
-	const Bus* FindRoute(std::string_view request_number);
-	const Stop* FindStop(std::string_view stop_name);
-	std::set<std::string>* FindAvailableRoutes(std::string_view stop_name);
+	// Строит сетку по координатам остановок для запросов Nearby. Вызывается после добавления всех остановок.
+	void BuildSpatialIndex();
+	std::vector<NearbyStop> FindStopsInRadius(geo::Coordinates center, double radius) const;
+	std::vector<NearbyStop> FindNearestStops(geo::Coordinates center, size_t count) const;
 
-	void AddDeserializedStop(location::Stop& stop, std::set<std::string>& aviable_routes);
+	// Строит префиксное дерево по названиям остановок для запросов StopSearch.
+	// Вызывается после добавления всех остановок.
+	void BuildNamesIndex();
+	const NameIndex& GetNamesIndex() const { return stops_names_index_; }
+	std::vector<const Stop*> FindStopsByPrefix(std::string_view prefix, size_t count, bool fuzzy) const;
+
+	void AddDeserializedStop(location::Stop& stop);
+	void AddDeserializedStopsIndex(std::vector<uint32_t> offsets, std::vector<uint32_t> bus_ids);
+	void AddDeserializedNamesIndex(NameIndex names_index);
 	void AddDeserializedBus(location::Bus& bus);
 	void AddDeserializedDistance(const Stop* from, const Stop* to, int distance);
 
-	RouteData GetRouteInformation(std::string_view request_number);
+	RouteData GetRouteInformation(std::string_view request_number) const;
 
 private:
 	std::deque<Stop> stops_;
 	std::deque<Bus> buses_;
-	std::unordered_map<const Stop*, std::set<std::string>> available_routes_;
+	std::vector<uint32_t> stop_buses_offsets_;
+	std::vector<uint32_t> stop_buses_;
 	std::unordered_map<std::pair<const Stop*, const Stop*>, int, location::detail::StopsPairHasher> stops_distances_;
+	std::vector<geo::PreparedCoordinates> stops_coordinates_;
+	geo::SpatialIndex stops_index_;
+	NameIndex stops_names_index_;
 	std::unordered_map<std::string_view, const Stop*, std::hash<std::string_view>> stops_auxiliary_map_;
 	std::unordered_map<std::string_view, const Bus*, std::hash<std::string_view>> buses_auxiliary_map_;
 };
 
+// Загруженный каталог, который больше не меняется. Все методы константные и не имеют скрытых изменяемых
+// состояний, поэтому снимок можно читать из любого числа потоков без блокировок.
+using CatalogueSnapshot = std::shared_ptr<const TransportCatalogue>;
+
+CatalogueSnapshot MakeSnapshot(TransportCatalogue&& transport_catalog);
+
+// Точка публикации снимков: читатели берут текущий снимок, писатель атомарно подменяет его новым.
+// Старый снимок живёт, пока его держит хотя бы один читатель.
+class SnapshotHolder {
+public:
+	CatalogueSnapshot Get() const {
+		return std::atomic_load(&snapshot_);
+	}
+	void Publish(CatalogueSnapshot snapshot) {
+		std::atomic_store(&snapshot_, std::move(snapshot));
+	}
+
+private:
+	CatalogueSnapshot snapshot_;
+};
+
 }// namespace location
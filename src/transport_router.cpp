@@ -2,49 +2,71 @@
 
 namespace graph {
 
-void TransportRouter::SetupRouter(location::TransportCatalogue& transport_catalog, int velocity, int wait_time) {
+void TransportRouter::SetupRouter(const location::TransportCatalogue& transport_catalog, int velocity, int wait_time) {
 	this->SetRoutingSettings(velocity, wait_time);
 	this->PrepareGraphAndRouter(transport_catalog);
 }
 
-void TransportRouter::CalculateRoute(std::string_view from, std::string_view to, json::Builder& request_result) {
-		using namespace std::literals;
-		if (from == to) {
-			request_result.Key("total_time"s).Value(0);
-			request_result.Key("items"s).StartArray();
-			request_result.EndArray();
-		} else {
-			auto thing = router_->BuildRoute(id_list_.stop_to_id.at(from), id_list_.stop_to_id.at(to));
-			if (thing.has_value()) {
-				request_result.Key("total_time"s).Value(thing.value().weight.time);
-				request_result.Key("items"s).StartArray();
-				for (auto& element : thing.value().edges) {
-					auto some_ = graph_holder_->GetEdge(element);
-					request_result.StartDict();
-					std::string_view stop_strv = id_list_.id_to_stop.at(some_.from);
-					std::string stop_namer(stop_strv.begin(), stop_strv.end());
-					request_result.Key("stop_name"s).Value(stop_namer);
-					request_result.Key("time"s).Value(settings.wait_time);
-					request_result.Key("type"s).Value("Wait");
-					request_result.EndDict();
-					request_result.StartDict();
-					std::string_view destination_strv = id_list_.id_to_stop.at(some_.to);
-					std::string destination_name(destination_strv.begin(), destination_strv.end());
-					std::string route_name(some_.weight.route_name.begin(), some_.weight.route_name.end());
-					request_result.Key("bus"s).Value(route_name);
-					request_result.Key("span_count"s).Value(some_.weight.span_count);
-					request_result.Key("time"s).Value(some_.weight.time - settings.wait_time);
-					request_result.Key("type"s).Value("Bus");
-					request_result.EndDict();
-				}
-				request_result.EndArray();
-			} else { request_result.Key("error_message"s).Value("not found"); }
-		}
+void TransportRouter::CalculateRoute(std::string_view from, std::string_view to, int request_id, json::Writer& request_result) const {
+	using namespace std::literals;
+	if (from == to) {
+		request_result.StartDict();
+		request_result.Key("items"sv).StartArray();
+		request_result.EndArray();
+		request_result.Key("request_id"sv).Value(request_id);
+		request_result.Key("total_time"sv).Value(0);
+		request_result.EndDict();
+	} else {
+		PrintRoute(FindRoute(from, to), request_id, request_result);
+	}
+}
+
+std::optional<RouteResult> TransportRouter::FindRoute(std::string_view from, std::string_view to) const {
+	auto thing = router_->BuildRoute(id_list_.stop_to_id.at(from), id_list_.stop_to_id.at(to));
+	if (!thing.has_value()) {
+		return std::nullopt;
+	}
+	RouteResult result{thing.value().weight.time, {}};
+	result.items.reserve(thing.value().edges.size());
+	for (auto& element : thing.value().edges) {
+		auto some_ = graph_holder_->GetEdge(element);
+		result.items.push_back({id_list_.id_to_stop.at(some_.from), some_.weight.route_name, some_.weight.span_count, some_.weight.time - settings.wait_time});
 	}
+	return result;
+}
+
+void TransportRouter::PrintRoute(const std::optional<RouteResult>& route, int request_id, json::Writer& request_result) const {
+	using namespace std::literals;
+	request_result.StartDict();
+	if (!route) {
+		request_result.Key("error_message"sv).Value("not found"sv);
+		request_result.Key("request_id"sv).Value(request_id);
+		request_result.EndDict();
+		return;
+	}
+	request_result.Key("items"sv).StartArray();
+	for (const RouteItem& item : route->items) {
+		request_result.StartDict();
+		request_result.Key("stop_name"sv).Value(item.stop_name);
+		request_result.Key("time"sv).Value(settings.wait_time);
+		request_result.Key("type"sv).Value("Wait"sv);
+		request_result.EndDict();
+		request_result.StartDict();
+		request_result.Key("bus"sv).Value(item.bus);
+		request_result.Key("span_count"sv).Value(item.span_count);
+		request_result.Key("time"sv).Value(item.time);
+		request_result.Key("type"sv).Value("Bus"sv);
+		request_result.EndDict();
+	}
+	request_result.EndArray();
+	request_result.Key("request_id"sv).Value(request_id);
+	request_result.Key("total_time"sv).Value(route->total_time);
+	request_result.EndDict();
+}
 
 //   -----------------------private-----------------------
 
-void TransportRouter::BuildPaths(location::TransportCatalogue& transport_catalog) {
+void TransportRouter::BuildPaths(const location::TransportCatalogue& transport_catalog) {
 	for (const location::Bus& bus : transport_catalog.GetRoutes()) {
 		for (size_t pos_from = 0; pos_from < bus.route_stops.size() - 1; ++pos_from) {
 			double result_time = 0.0;
@@ -52,18 +74,18 @@ void TransportRouter::BuildPaths(location::TransportCatalogue& transport_catalog
 			double reverse_result_time = 0.0;
 			int reverse_stop_count = 0;
 			size_t prev_reverse_start = (bus.route_stops.size() - 1) - pos_from;
-			result_time += CalculateTime(transport_catalog, bus, pos_from, pos_from+1);
+			result_time += CalculateTime(bus, pos_from, pos_from+1);
 			++stop_count;
 			for (size_t pos_to = pos_from + 1; pos_to < bus.route_stops.size(); ++pos_to) {
 				edges_.push_back({id_list_.stop_to_id.at(bus.route_stops[pos_from]->name), id_list_.stop_to_id.at(bus.route_stops[pos_to]->name), {bus.route_number, stop_count, result_time + settings.wait_time}});
 				if (pos_to != bus.route_stops.size() - 1) {
-					result_time += CalculateTime(transport_catalog, bus, pos_to, pos_to+1);
+					result_time += CalculateTime(bus, pos_to, pos_to+1);
 					++stop_count;
 				}
 				if (!bus.is_circular) {
 					int reverse_from = (bus.route_stops.size() - 1) - pos_from;
 					int reverse_to = (bus.route_stops.size() - 1) - pos_to;
-					reverse_result_time += CalculateTime(transport_catalog, bus, prev_reverse_start, reverse_to);
+					reverse_result_time += CalculateTime(bus, prev_reverse_start, reverse_to);
 					++reverse_stop_count;
 					prev_reverse_start = reverse_to;
 					edges_.push_back({id_list_.stop_to_id.at(bus.route_stops[reverse_from]->name), id_list_.stop_to_id.at(bus.route_stops[reverse_to]->name), {bus.route_number, reverse_stop_count, reverse_result_time + settings.wait_time}});
@@ -73,8 +95,10 @@ void TransportRouter::BuildPaths(location::TransportCatalogue& transport_catalog
 	}
 }
 
-inline double TransportRouter::CalculateTime(location::TransportCatalogue& transport_catalog, const location::Bus& bus, size_t from, size_t to) {
-	double dist_km = (transport_catalog.GetDistance(bus.route_stops[from], bus.route_stops[to]) / 1000.0) ;
+// from и to - соседние остановки маршрута, порядок задаёт направление перегона
+inline double TransportRouter::CalculateTime(const location::Bus& bus, size_t from, size_t to) const {
+	int distance = from < to ? bus.forward_distances[from] : bus.backward_distances[to];
+	double dist_km = (distance / 1000.0) ;
 	return (dist_km / settings.velocity) * 60.0;
 }
 
@@ -83,7 +107,7 @@ void TransportRouter::SetRoutingSettings(int velocity, int wait_time) {
 	settings.wait_time = wait_time;
 }
 
-void TransportRouter::PrepareGraphAndRouter(location::TransportCatalogue& transport_catalog) {
+void TransportRouter::PrepareGraphAndRouter(const location::TransportCatalogue& transport_catalog) {
 	int counter = 0;
 	for (auto& item : transport_catalog.GetStops()) {;
 		id_list_.stop_to_id.insert({item.name, counter});
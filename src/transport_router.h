@@ -1,11 +1,12 @@
 #pragma once
 
-#include "json_builder.h"
+#include "json_writer.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 
 namespace graph {
@@ -25,6 +26,19 @@ inline bool operator>(const EdgeData& A, const EdgeData& B) { return A.time > B.
 inline bool operator<(const EdgeData& A, const EdgeData& B) { return A.time < B.time; }
 inline EdgeData operator+(const EdgeData& A, const EdgeData& B) { return {{}, 0, A.time + B.time}; }
 
+// Ожидание на остановке stop_name и поездка на автобусе bus через span_count перегонов
+struct RouteItem {
+	std::string_view stop_name;
+	std::string_view bus;
+	int span_count;
+	double time;
+};
+
+struct RouteResult {
+	double total_time;
+	std::vector<RouteItem> items;
+};
+
 class TransportRouter {
 	struct Settings {
 		int velocity = 0;
@@ -32,9 +46,13 @@ class TransportRouter {
 	};
 
 public:
-	void SetupRouter(location::TransportCatalogue& transport_catalog, int velocity, int wait_time);
+	void SetupRouter(const location::TransportCatalogue& transport_catalog, int velocity, int wait_time);
 
-	void CalculateRoute(std::string_view from, std::string_view to, json::Builder& request_result);
+	// Пишут словарь ответа целиком: ключи выводятся по алфавиту, request_id оказывается между items и total_time
+	void CalculateRoute(std::string_view from, std::string_view to, int request_id, json::Writer& request_result) const;
+	std::optional<RouteResult> FindRoute(std::string_view from, std::string_view to) const;
+	void PrintRoute(const std::optional<RouteResult>& route, int request_id, json::Writer& request_result) const;
+	void SetRoutingSettings(int velocity, int wait_time);
 
 	const IDList* GetIDList() const { return &id_list_;	}
 	const Settings* GetSettings() const { return &settings;	}
@@ -46,10 +64,9 @@ private:
 	IDList id_list_;
 	Settings settings;
 
-	void BuildPaths(location::TransportCatalogue& transport_catalog);
-	inline double CalculateTime(location::TransportCatalogue& transport_catalog, const location::Bus& bus, size_t from, size_t to);
-	void SetRoutingSettings(int velocity, int wait_time);
-	void PrepareGraphAndRouter(location::TransportCatalogue& transport_catalog);
+	void BuildPaths(const location::TransportCatalogue& transport_catalog);
+	inline double CalculateTime(const location::Bus& bus, size_t from, size_t to) const;
+	void PrepareGraphAndRouter(const location::TransportCatalogue& transport_catalog);
 };
 
 }// namespace graph
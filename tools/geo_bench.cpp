@@ -0,0 +1,88 @@
+#include "geo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Лучшее из нескольких повторов время, с
+template <typename Function>
+double Measure(Function function) {
+	double best = 1e9;
+	for (int i = 0; i < 5; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+void Report(const char* name, double seconds, size_t count) {
+	std::printf("%-28s %8.1f ms %7.1f Mpairs/s\n", name, seconds * 1e3, static_cast<double>(count) / 1e6 / seconds);
+}
+
+}// namespace
+
+// geo_bench [count] - пропускная способность скалярного и пакетного расчёта расстояний
+int main(int argc, char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	std::mt19937 random(1);
+	// остановки одного города, как в make_base.json
+	std::uniform_real_distribution<double> lat(43.5, 43.7);
+	std::uniform_real_distribution<double> lng(39.6, 39.8);
+
+	std::vector<geo::Coordinates> from;
+	std::vector<geo::Coordinates> to;
+	std::vector<geo::PreparedCoordinates> prepared_from;
+	std::vector<geo::PreparedCoordinates> prepared_to;
+	for (size_t i = 0; i < count; ++i) {
+		from.push_back({lat(random), lng(random)});
+		to.push_back({lat(random), lng(random)});
+		prepared_from.push_back(geo::Prepare(from.back()));
+		prepared_to.push_back(geo::Prepare(to.back()));
+	}
+
+	std::vector<double> scalar(count);
+	std::vector<double> batch(count);
+	Report("ComputeDistance(Coordinates)", Measure([&] {
+			   for (size_t i = 0; i < count; ++i) {
+				   scalar[i] = geo::ComputeDistance(from[i], to[i]);
+			   }
+		   }),
+		   count);
+	Report("ComputeDistance(Prepared)", Measure([&] {
+			   for (size_t i = 0; i < count; ++i) {
+				   batch[i] = geo::ComputeDistance(prepared_from[i], prepared_to[i]);
+			   }
+		   }),
+		   count);
+	Report("ComputeDistances pairwise", Measure([&] {
+			   geo::ComputeDistances(prepared_from.data(), prepared_to.data(), batch.data(), count);
+		   }),
+		   count);
+	if (scalar != batch) {
+		std::fprintf(stderr, "pairwise results differ from ComputeDistance\n");
+		return EXIT_FAILURE;
+	}
+
+	Report("ComputeDistance one-to-many", Measure([&] {
+			   for (size_t i = 0; i < count; ++i) {
+				   scalar[i] = geo::ComputeDistance(from[0], to[i]);
+			   }
+		   }),
+		   count);
+	Report("ComputeDistances one-to-many", Measure([&] {
+			   geo::ComputeDistances(prepared_from[0], prepared_to.data(), batch.data(), count);
+		   }),
+		   count);
+	if (scalar != batch) {
+		std::fprintf(stderr, "one-to-many results differ from ComputeDistance\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
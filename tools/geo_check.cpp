@@ -0,0 +1,73 @@
+#include "geo.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool Identical(double lhs, double rhs) {
+	return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+}// namespace
+
+// geo_check [count] - пакетный ComputeDistances должен давать те же биты, что и скалярный ComputeDistance
+int main(int argc, char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> lat(-90, 90);
+	std::uniform_real_distribution<double> lng(-180, 180);
+
+	std::vector<geo::Coordinates> from;
+	std::vector<geo::Coordinates> to;
+	for (size_t i = 0; i < count; ++i) {
+		const geo::Coordinates point{lat(random), lng(random)};
+		from.push_back(point);
+		switch (i % 8) {
+			case 0:
+				// совпадающие точки: аргумент acos может превысить 1
+				to.push_back(point);
+				break;
+			case 1:
+				// антиподы
+				to.push_back({-point.lat, point.lng > 0 ? point.lng - 180 : point.lng + 180});
+				break;
+			case 2:
+				// соседние остановки в паре метров друг от друга
+				to.push_back({point.lat + 1e-5, point.lng - 1e-5});
+				break;
+			default:
+				to.push_back({lat(random), lng(random)});
+				break;
+		}
+	}
+
+	std::vector<geo::PreparedCoordinates> prepared_from;
+	std::vector<geo::PreparedCoordinates> prepared_to;
+	for (size_t i = 0; i < count; ++i) {
+		prepared_from.push_back(geo::Prepare(from[i]));
+		prepared_to.push_back(geo::Prepare(to[i]));
+	}
+
+	std::vector<double> pairwise(count);
+	std::vector<double> one_to_many(count);
+	geo::ComputeDistances(prepared_from.data(), prepared_to.data(), pairwise.data(), count);
+	geo::ComputeDistances(prepared_from[0], prepared_to.data(), one_to_many.data(), count);
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const double expected = geo::ComputeDistance(from[i], to[i]);
+		const double expected_from_first = geo::ComputeDistance(from[0], to[i]);
+		if (!Identical(expected, pairwise[i]) || !Identical(expected_from_first, one_to_many[i])) {
+			if (++mismatches <= 10) {
+				std::fprintf(stderr, "(%.17g, %.17g) - (%.17g, %.17g): %.17g != %.17g or %.17g != %.17g\n", from[i].lat, from[i].lng,
+							 to[i].lat, to[i].lng, expected, pairwise[i], expected_from_first, one_to_many[i]);
+			}
+		}
+	}
+	std::printf("%zu pairs: %zu mismatches\n", count, mismatches);
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
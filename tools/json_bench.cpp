@@ -0,0 +1,91 @@
+#include "json.h"
+#include "json_generator.h"
+#include "json_reference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Обработчик без работы: измеряется только разбор
+class NullHandler final : public json::Handler {
+public:
+	void StartDict() override {
+		++count_;
+	}
+	void EndDict() override {
+	}
+	void StartArray() override {
+		++count_;
+	}
+	void EndArray() override {
+	}
+	void Key(std::string_view key, bool) override {
+		count_ += key.size();
+	}
+	void String(std::string_view value, bool) override {
+		count_ += value.size();
+	}
+	void Value(json::Node) override {
+		++count_;
+	}
+
+	size_t Count() const {
+		return count_;
+	}
+
+private:
+	size_t count_ = 0;
+};
+
+// Лучшее из нескольких повторов время, с
+template <typename Function>
+double Measure(Function function) {
+	double best = 1e9;
+	for (int i = 0; i < 5; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+void Report(const char* name, double seconds, size_t size) {
+	std::printf("%-22s %8.1f ms %6.2f GB/s\n", name, seconds * 1e3, static_cast<double>(size) / 1e9 / seconds);
+}
+
+}// namespace
+
+// json_bench [path] - скорость разбора файла или сгенерированного документа в 64 МБ
+int main(int argc, char** argv) {
+	const auto buffer = argc > 1 ? json::Buffer::MapFile(argv[1])
+								 : json::Buffer::FromString(json_reference::Generator(1).Large(64 << 20));
+	const size_t size = buffer->Text().size();
+
+	size_t reference_count = 0;
+	size_t count = 0;
+	Report("reference Parse", Measure([&] {
+			   NullHandler handler;
+			   json_reference::Parse(buffer->Text(), handler);
+			   reference_count = handler.Count();
+		   }),
+		   size);
+	Report("json::Parse", Measure([&] {
+			   NullHandler handler;
+			   json::Parse(*buffer, handler);
+			   count = handler.Count();
+		   }),
+		   size);
+	Report("json::Load", Measure([&] {
+			   json::Load(buffer);
+		   }),
+		   size);
+	if (count != reference_count) {
+		std::fprintf(stderr, "parsers disagree: %zu vs %zu events\n", count, reference_count);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
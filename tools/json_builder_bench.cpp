@@ -0,0 +1,114 @@
+#include "json.h"
+#include "json_builder.h"
+#include "json_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+// Все выделения памяти через глобальный operator new подсчитываются
+namespace {
+size_t allocations = 0;
+size_t allocated_bytes = 0;
+}// namespace
+
+void* operator new(size_t size) {
+	++allocations;
+	allocated_bytes += size;
+	if (void* data = std::malloc(size)) {
+		return data;
+	}
+	throw std::bad_alloc();
+}
+
+// std::pmr::new_delete_resource выделяет память с явным выравниванием
+void* operator new(size_t size, std::align_val_t alignment) {
+	++allocations;
+	allocated_bytes += size;
+	const size_t align = static_cast<size_t>(alignment);
+	if (void* data = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+		return data;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept {
+	std::free(data);
+}
+
+void operator delete(void* data, size_t) noexcept {
+	std::free(data);
+}
+
+void operator delete(void* data, std::align_val_t) noexcept {
+	std::free(data);
+}
+
+void operator delete(void* data, size_t, std::align_val_t) noexcept {
+	std::free(data);
+}
+
+namespace {
+
+constexpr int ITEM_COUNT = 100000;
+
+// Ответ из ITEM_COUNT словарей {request_id, stop_name, items: [double]}; имя длиннее 14 байт
+// и потому копируется в ресурс, а не хранится внутри узла
+template <typename Output>
+void WriteResponse(Output& output, const std::vector<std::string>& names) {
+	output.StartArray();
+	for (int i = 0; i < ITEM_COUNT; ++i) {
+		output.StartDict().Key("request_id").Value(i).Key("stop_name").Value(std::string_view(names[i])).Key("items").StartArray();
+		output.Value(i * 0.5).Value(i * 0.25).EndArray().EndDict();
+	}
+	output.EndArray();
+}
+
+// Выделения и время построения ответа, освобождение результата входит в замер
+template <typename Build>
+bool Measure(const char* name, Build build) {
+	const size_t allocations_before = allocations;
+	const size_t bytes_before = allocated_bytes;
+	const auto start = std::chrono::steady_clock::now();
+	const size_t size = build();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%-28s %8zu allocations %7.1f MB %6.1f ms\n", name, allocations - allocations_before,
+				static_cast<double>(allocated_bytes - bytes_before) / 1e6, seconds * 1e3);
+	return size == ITEM_COUNT;
+}
+
+}// namespace
+
+// json_builder_bench - выделения памяти при построении ответа из 100 тысяч элементов.
+// json::Builder в ответах каталога не используется (их выводит json::Writer), это библиотечный API
+int main() {
+	// имена готовятся заранее, чтобы в замер не попадали выделения вызывающего
+	std::vector<std::string> names;
+	for (int i = 0; i < ITEM_COUNT; ++i) {
+		names.push_back("Остановка " + std::to_string(i));
+	}
+
+	bool ok = Measure("Builder", [&names] {
+		json::Builder builder;
+		WriteResponse(builder, names);
+		return builder.Build().AsArray().size();
+	});
+	ok = Measure("Builder, arena", [&names] {
+		std::pmr::monotonic_buffer_resource arena;
+		json::Builder builder(&arena);
+		WriteResponse(builder, names);
+		return builder.Build().AsArray().size();
+	}) && ok;
+	ok = Measure("Writer + NodeBuilder, arena", [&names] {
+		std::pmr::monotonic_buffer_resource arena;
+		json::NodeBuilder builder(&arena);
+		json::Writer writer(builder);
+		WriteResponse(writer, names);
+		return builder.Extract().AsArray().size();
+	}) && ok;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include "json.h"
+#include "json_generator.h"
+#include "json_reference.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+// Записывает события разбора в строку, числа - без потери точности
+class Recorder final : public json::Handler {
+public:
+	void StartDict() override {
+		events_.push_back('{');
+	}
+	void EndDict() override {
+		events_.push_back('}');
+	}
+	void StartArray() override {
+		events_.push_back('[');
+	}
+	void EndArray() override {
+		events_.push_back(']');
+	}
+	void Key(std::string_view key, bool persistent) override {
+		Append(persistent ? 'K' : 'k', key);
+	}
+	void String(std::string_view value, bool persistent) override {
+		Append(persistent ? 'S' : 's', value);
+	}
+	void Value(json::Node value) override {
+		char buffer[64];
+		int size = 0;
+		if (value.IsNull()) {
+			size = std::snprintf(buffer, sizeof(buffer), "n");
+		} else if (value.IsBool()) {
+			size = std::snprintf(buffer, sizeof(buffer), "b%d", value.AsBool() ? 1 : 0);
+		} else if (value.IsInt()) {
+			size = std::snprintf(buffer, sizeof(buffer), "i%d", value.AsInt());
+		} else {
+			size = std::snprintf(buffer, sizeof(buffer), "d%.17g", value.AsDouble());
+		}
+		events_.append(buffer, static_cast<size_t>(size));
+		events_.push_back(';');
+	}
+
+	std::string Extract() {
+		return std::move(events_);
+	}
+
+private:
+	void Append(char type, std::string_view text) {
+		events_.push_back(type);
+		events_ += std::to_string(text.size());
+		events_.push_back(':');
+		events_ += text;
+	}
+
+	std::string events_;
+};
+
+// Ошибку оба разборщика должны обнаружить, но её текст не сравнивается
+template <typename ParseFunction>
+std::string Run(ParseFunction parse) {
+	Recorder recorder;
+	try {
+		parse(recorder);
+	} catch (const json::ParsingError&) {
+		return "error"s;
+	} catch (const std::exception& e) {
+		return "exception "s + e.what();
+	}
+	return recorder.Extract();
+}
+
+bool Compare(const json::Buffer& buffer, const std::string& name) {
+	const std::string expected = Run([&buffer](json::Handler& handler) {
+		json_reference::Parse(buffer.Text(), handler);
+	});
+	const std::string actual = Run([&buffer](json::Handler& handler) {
+		json::Parse(buffer, handler);
+	});
+	if (expected == actual) {
+		return true;
+	}
+	std::cerr << name << ": events differ from the reference parser\n  expected: "sv << expected.substr(0, 200)
+			  << "\n  actual:   "sv << actual.substr(0, 200) << '\n';
+	return false;
+}
+
+}// namespace
+
+// json_diff [seed [count]] - сравнивает разбор случайных документов с эталоном
+// json_diff --file path... - то же для готовых файлов, отображённых в память
+int main(int argc, char** argv) {
+	if (argc > 1 && argv[1] == "--file"sv) {
+		bool ok = true;
+		for (int i = 2; i < argc; ++i) {
+			ok = Compare(*json::Buffer::MapFile(argv[i]), argv[i]) && ok;
+		}
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	const uint32_t seed = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1;
+	const size_t count = argc > 2 ? std::stoul(argv[2]) : 20000;
+	json_reference::Generator generator(seed);
+	size_t failures = 0;
+	for (size_t i = 0; i < count; ++i) {
+		std::string text = generator.Document(i % 2 == 1);
+		const std::string name = "json_diff_"s + std::to_string(seed) + "_"s + std::to_string(i) + ".json"s;
+		if (!Compare(*json::Buffer::FromString(text), name)) {
+			// документ сохраняется для повторного запуска с --file
+			std::ofstream(name, std::ios::binary) << text;
+			if (++failures == 10) {
+				break;
+			}
+		}
+	}
+	std::cout << "seed "sv << seed << ": "sv << failures << " mismatches"sv << std::endl;
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,218 @@
+#include "json_generator.h"
+
+#include <cstdio>
+#include <iterator>
+
+namespace json_reference {
+
+namespace {
+using namespace std::literals;
+
+constexpr size_t BLOCK_SIZE = 64;
+constexpr size_t WINDOW_SIZE = 64 * 1024;
+
+template <size_t N>
+char Pick(std::mt19937& random, const char (&chars)[N]) {
+	return chars[std::uniform_int_distribution<size_t>(0, N - 2)(random)];
+}
+
+}// namespace
+
+size_t Generator::Uniform(size_t from, size_t to) {
+	return std::uniform_int_distribution<size_t>(from, to)(random_);
+}
+
+bool Generator::Chance(double probability) {
+	return std::bernoulli_distribution(probability)(random_);
+}
+
+void Generator::AppendSpace(std::string& out) {
+	if (Chance(0.6)) {
+		return;
+	}
+	// длинные серии пробелов сдвигают следующий токен через границу блока
+	const size_t count = Chance(0.05) ? Uniform(BLOCK_SIZE - 8, 3 * BLOCK_SIZE) : Uniform(1, 4);
+	for (size_t i = 0; i < count; ++i) {
+		out.push_back(Pick(random_, " \n\t\r"));
+	}
+}
+
+void Generator::AppendString(std::string& out) {
+	out.push_back('"');
+	const size_t parts = Uniform(0, 12);
+	for (size_t i = 0; i < parts; ++i) {
+		switch (Uniform(0, 9)) {
+			case 0:
+				out += "\\\""sv;
+				break;
+			case 1:
+				out += "\\\\"sv;
+				break;
+			case 2:
+				out.push_back('\\');
+				out.push_back(Pick(random_, "ntr"));
+				break;
+			case 3:
+				out += "\xc3\xa9"sv;
+				break;
+			case 4: {
+				// кавычка или \ на краю блока: серия перед ними длиной около 64 байт
+				const size_t run = Chance(0.02) ? Uniform(WINDOW_SIZE - BLOCK_SIZE, WINDOW_SIZE + BLOCK_SIZE)
+												: Uniform(BLOCK_SIZE - 4, 2 * BLOCK_SIZE + 4);
+				// серия обратных косых черт чётной длины - это экранированные пары
+				const char c = Pick(random_, "x\\ /");
+				out.append(c == '\\' ? run & ~size_t{1} : run, c);
+				break;
+			}
+			default:
+				out.push_back(Pick(random_, "ab /:,{}[]01"));
+				break;
+		}
+	}
+	out.push_back('"');
+}
+
+void Generator::AppendNumber(std::string& out) {
+	char buffer[64];
+	int size = 0;
+	switch (Uniform(0, 5)) {
+		case 0:
+			size = std::snprintf(buffer, sizeof(buffer), "%d", static_cast<int>(Uniform(0, 2000)) - 1000);
+			break;
+		case 1:
+			// на границах int разбор переходит к double
+			size = std::snprintf(buffer, sizeof(buffer), "%lld", (Chance(0.5) ? -1LL : 1LL) * static_cast<long long>(Uniform(2147483640ULL, 2147483660ULL)));
+			break;
+		case 2:
+			size = std::snprintf(buffer, sizeof(buffer), "%.*f", static_cast<int>(Uniform(1, 17)), std::uniform_real_distribution<double>(-1e5, 1e5)(random_));
+			break;
+		case 3:
+			size = std::snprintf(buffer, sizeof(buffer), "%.*e", static_cast<int>(Uniform(0, 17)), std::uniform_real_distribution<double>(-1e5, 1e5)(random_));
+			break;
+		case 4:
+			size = std::snprintf(buffer, sizeof(buffer), "%dE%c%d", static_cast<int>(Uniform(0, 9)), Pick(random_, "+-"), static_cast<int>(Uniform(0, 400)));
+			break;
+		default:
+			size = std::snprintf(buffer, sizeof(buffer), "%s", Chance(0.5) ? "0" : "-0.0");
+			break;
+	}
+	out.append(buffer, static_cast<size_t>(size));
+}
+
+void Generator::AppendValue(std::string& out, int depth) {
+	AppendSpace(out);
+	const size_t kind = depth > 4 ? Uniform(0, 5) : Uniform(0, 7);
+	switch (kind) {
+		case 0:
+		case 1:
+			AppendString(out);
+			break;
+		case 2:
+		case 3:
+			AppendNumber(out);
+			break;
+		case 4:
+			out += Chance(0.5) ? "true"sv : "false"sv;
+			break;
+		case 5:
+			out += "null"sv;
+			break;
+		case 6: {
+			out.push_back('[');
+			const size_t count = Uniform(0, 6);
+			for (size_t i = 0; i < count; ++i) {
+				if (i > 0) {
+					out.push_back(',');
+				}
+				AppendValue(out, depth + 1);
+			}
+			AppendSpace(out);
+			out.push_back(']');
+			break;
+		}
+		default: {
+			out.push_back('{');
+			const size_t count = Uniform(0, 6);
+			for (size_t i = 0; i < count; ++i) {
+				if (i > 0) {
+					out.push_back(',');
+				}
+				AppendSpace(out);
+				// ключи различаются, иначе документ отвергается из-за повтора
+				out += "\"k"sv;
+				out += std::to_string(i);
+				if (Chance(0.2)) {
+					out += "\\\"\\\\"sv;
+				}
+				out.push_back('"');
+				AppendSpace(out);
+				out.push_back(':');
+				AppendValue(out, depth + 1);
+			}
+			AppendSpace(out);
+			out.push_back('}');
+			break;
+		}
+	}
+	AppendSpace(out);
+}
+
+void Generator::Mutate(std::string& text) {
+	const size_t count = Uniform(1, 3);
+	for (size_t i = 0; i < count; ++i) {
+		const size_t pos = Uniform(0, text.size());
+		const char c = Pick(random_, "\"\\{}[]:, \n\tab01-.etrufl\r\v");
+		switch (Uniform(0, 2)) {
+			case 0:
+				if (pos < text.size()) {
+					text.erase(pos, 1);
+				}
+				break;
+			case 1:
+				text.insert(text.begin() + static_cast<std::ptrdiff_t>(pos), c);
+				break;
+			default:
+				if (pos < text.size()) {
+					text[pos] = c;
+				}
+				break;
+		}
+	}
+}
+
+std::string Generator::Document(bool mutate) {
+	std::string text;
+	if (Chance(0.01)) {
+		// документ начинается у самой границы окна в 64 КБ
+		text.append(WINDOW_SIZE - Uniform(0, BLOCK_SIZE), ' ');
+	}
+	AppendValue(text, 0);
+	if (mutate) {
+		Mutate(text);
+	}
+	return text;
+}
+
+std::string Generator::Large(size_t size) {
+	std::string text = "{\"base_requests\": ["s;
+	for (size_t i = 0; text.size() < size; ++i) {
+		char buffer[256];
+		const int written = std::snprintf(buffer, sizeof(buffer),
+										  "\n    {\n        \"type\": \"Stop\",\n        \"name\": \"Stop %zu\",\n"
+										  "        \"latitude\": %.6f,\n        \"longitude\": %.6f,\n"
+										  "        \"road_distances\": {\"Stop %zu\": %zu}\n    },",
+										  i, 43.0 + static_cast<double>(Uniform(0, 999999)) / 1e6,
+										  39.0 + static_cast<double>(Uniform(0, 999999)) / 1e6, i + 1, Uniform(100, 5000));
+		text.append(buffer, static_cast<size_t>(written));
+		if (i % 8 == 0) {
+			// строки с экранированием, числа вне диапазона double сюда не попадают
+			text += "\n    "sv;
+			AppendString(text);
+			text.push_back(',');
+		}
+	}
+	text += "\n    null\n]}"sv;
+	return text;
+}
+
+}// namespace json_reference
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace json_reference {
+
+// Случайные JSON-документы для сравнения разборщиков. Строки, пробелы и числа подбираются так,
+// чтобы границы токенов попадали на края блоков по 64 байта и окон по 64 КБ
+class Generator {
+public:
+	explicit Generator(uint32_t seed)
+		: random_(seed) {
+	}
+
+	// Корректный документ; при mutate в него вносятся случайные правки, чаще всего ломающие его
+	std::string Document(bool mutate);
+	// Корректный документ размером не меньше size, близкий по составу к make_base.json
+	std::string Large(size_t size);
+
+private:
+	size_t Uniform(size_t from, size_t to);
+	bool Chance(double probability);
+
+	void AppendValue(std::string& out, int depth);
+	void AppendString(std::string& out);
+	void AppendNumber(std::string& out);
+	void AppendSpace(std::string& out);
+	void Mutate(std::string& text);
+
+	std::mt19937 random_;
+};
+
+}// namespace json_reference
@@ -0,0 +1,292 @@
+#include "json_reference.h"
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+
+namespace json_reference {
+
+namespace {
+using namespace std::literals;
+using json::Node;
+using json::ParsingError;
+
+// Позиция разбора в непрерывном тексте документа
+struct Input {
+	const char* pos;
+	const char* end;
+
+	bool AtEnd() const {
+		return pos == end;
+	}
+	int Peek() const {
+		return pos != end ? static_cast<unsigned char>(*pos) : EOF;
+	}
+	// Пропускает пробельные символы и читает следующий символ; false в конце текста
+	bool NextToken(char& c) {
+		while (pos != end && std::isspace(static_cast<unsigned char>(*pos))) {
+			++pos;
+		}
+		if (pos == end) {
+			return false;
+		}
+		c = *pos++;
+		return true;
+	}
+};
+
+// Разбор порождает события для Events: json::Handler при потоковом чтении или NodeBuilder,
+// вызовы которого благодаря final не виртуальные
+template <typename Events>
+void ParseNode(Input& input, Events& events);
+
+std::string_view LoadLiteral(Input& input) {
+	const char* begin = input.pos;
+	while (std::isalpha(input.Peek())) {
+		++input.pos;
+	}
+	return {begin, static_cast<size_t>(input.pos - begin)};
+}
+
+template <typename Events>
+void ParseArray(Input& input, Events& events) {
+	events.StartArray();
+
+	char c = 0;
+	bool closed = false;
+	while (input.NextToken(c)) {
+		if (c == ']') {
+			closed = true;
+			break;
+		}
+		if (c != ',') {
+			--input.pos;
+		}
+		ParseNode(input, events);
+	}
+	if (!closed) {
+		throw ParsingError("Array parsing error"s);
+	}
+	events.EndArray();
+}
+
+// Строка без escape-последовательностей возвращается как string_view на текст документа
+// (persistent = true), иначе собирается в storage
+std::string_view LoadString(Input& input, std::string& storage, bool& persistent) {
+	const char* begin = input.pos;
+	const char* it = begin;
+	while (it != input.end && *it != '"' && *it != '\\' && *it != '\n' && *it != '\r') {
+		++it;
+	}
+	if (it != input.end && *it == '"') {
+		input.pos = it + 1;
+		persistent = true;
+		return {begin, static_cast<size_t>(it - begin)};
+	}
+
+	std::string& s = storage;
+	s.assign(begin, it);
+	while (true) {
+		if (it == input.end) {
+			throw ParsingError("String parsing error");
+		}
+		const char ch = *it;
+		if (ch == '"') {
+			++it;
+			break;
+		} else if (ch == '\\') {
+			++it;
+			if (it == input.end) {
+				throw ParsingError("String parsing error");
+			}
+			const char escaped_char = *(it);
+			switch (escaped_char) {
+				case 'n':
+					s.push_back('\n');
+					break;
+				case 't':
+					s.push_back('\t');
+					break;
+				case 'r':
+					s.push_back('\r');
+					break;
+				case '"':
+					s.push_back('"');
+					break;
+				case '\\':
+					s.push_back('\\');
+					break;
+				default:
+					throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+			}
+		} else if (ch == '\n' || ch == '\r') {
+			throw ParsingError("Unexpected end of line"s);
+		} else {
+			s.push_back(ch);
+		}
+		++it;
+	}
+	input.pos = it;
+	persistent = false;
+	return s;
+}
+
+template <typename Events>
+void ParseDict(Input& input, Events& events) {
+	events.StartDict();
+
+	std::string storage;
+	char c = 0;
+	bool closed = false;
+	while (input.NextToken(c)) {
+		if (c == '}') {
+			closed = true;
+			break;
+		}
+		if (c == '"') {
+			bool persistent = false;
+			const std::string_view key = LoadString(input, storage, persistent);
+			if (input.NextToken(c) && c == ':') {
+				events.Key(key, persistent);
+				ParseNode(input, events);
+			} else {
+				throw ParsingError(": is expected but '"s + c + "' has been found"s);
+			}
+		} else if (c != ',') {
+			throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+		}
+	}
+	if (!closed) {
+		throw ParsingError("Dictionary parsing error"s);
+	}
+	events.EndDict();
+}
+
+Node LoadBool(Input& input) {
+	const auto s = LoadLiteral(input);
+	if (s == "true"sv) {
+		return Node{true};
+	} else if (s == "false"sv) {
+		return Node{false};
+	} else {
+		throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+	}
+}
+
+Node LoadNull(Input& input) {
+	if (auto literal = LoadLiteral(input); literal == "null"sv) {
+		return Node{nullptr};
+	} else {
+		throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+	}
+}
+
+Node LoadNumber(Input& input) {
+	const char* begin = input.pos;
+
+	// Пропускает одну или более цифр
+	auto read_digits = [&input] {
+		if (!std::isdigit(input.Peek())) {
+			throw ParsingError("A digit is expected"s);
+		}
+		while (std::isdigit(input.Peek())) {
+			++input.pos;
+		}
+	};
+
+	if (input.Peek() == '-') {
+		++input.pos;
+	}
+	// Парсим целую часть числа
+	if (input.Peek() == '0') {
+		++input.pos;
+		// После 0 в JSON не могут идти другие цифры
+	} else {
+		read_digits();
+	}
+
+	bool is_int = true;
+	// Парсим дробную часть числа
+	if (input.Peek() == '.') {
+		++input.pos;
+		read_digits();
+		is_int = false;
+	}
+
+	// Парсим экспоненциальную часть числа
+	if (int ch = input.Peek(); ch == 'e' || ch == 'E') {
+		++input.pos;
+		if (ch = input.Peek(); ch == '+' || ch == '-') {
+			++input.pos;
+		}
+		read_digits();
+		is_int = false;
+	}
+
+	const std::string parsed_num(begin, input.pos);
+	try {
+		if (is_int) {
+			// Сначала пробуем преобразовать строку в int
+			try {
+				return std::stoi(parsed_num);
+			} catch (...) {
+				// В случае неудачи, например, при переполнении
+				// код ниже попробует преобразовать строку в double
+			}
+		}
+		return std::stod(parsed_num);
+	} catch (...) {
+		throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+	}
+}
+
+template <typename Events>
+void ParseNode(Input& input, Events& events) {
+	char c;
+	if (!input.NextToken(c)) {
+		throw ParsingError("Unexpected EOF"s);
+	}
+	switch (c) {
+		case '[':
+			ParseArray(input, events);
+			break;
+		case '{':
+			ParseDict(input, events);
+			break;
+		case '"': {
+			std::string storage;
+			bool persistent = false;
+			const std::string_view value = LoadString(input, storage, persistent);
+			events.String(value, persistent);
+			break;
+		}
+		case 't':
+			// Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
+			// подсказкой компилятору и человеку, что здесь программист явно задумывал
+			// разрешить переход к инструкции следующей ветки case, а не случайно забыл
+			// написать break, return или throw.
+			// В данном случае, встретив t или f, переходим к попытке парсинга
+			// литералов true либо false
+			[[fallthrough]];
+		case 'f':
+			--input.pos;
+			events.Value(LoadBool(input));
+			break;
+		case 'n':
+			--input.pos;
+			events.Value(LoadNull(input));
+			break;
+		default:
+			--input.pos;
+			events.Value(LoadNumber(input));
+			break;
+	}
+}
+}// namespace
+
+void Parse(std::string_view text, json::Handler& handler) {
+	Input input{text.data(), text.data() + text.size()};
+	ParseNode(input, handler);
+}
+
+}// namespace json_reference
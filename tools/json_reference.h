@@ -0,0 +1,13 @@
+#pragma once
+
+#include "json.h"
+
+#include <string_view>
+
+// Разбор JSON в том виде, в каком он был до появления структурного индекса (посимвольно).
+// Служит эталоном для json_diff и json_bench: события json::Parse должны совпадать с ним
+namespace json_reference {
+
+void Parse(std::string_view text, json::Handler& handler);
+
+}// namespace json_reference